@@ -0,0 +1,257 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/bench.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+// Synthesis benchmarks, run with `make bench`. Prints JSON to stdout:
+// samples per second for every channel type over a sweep of notes and
+// octaves, then for whole renders of made-up songs with 1 to 255 instruments,
+// then how long a song with 1024 instruments and 1024 orders takes to save,
+// load and play compared to real time. A few of its instruments have more than
+// 255 patterns. Exits with 1 if that song plays slower than real time, or
+// doesn't come back from saving and loading with the same order indexes.
+// Usage: bench.out [seconds per measurement]
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fmt/core.h>
+#include <string>
+#include <vector>
+#include "channel.hxx"
+#include "mixer.hxx"
+#include "order.hxx"
+#include "player.hxx"
+#include "song.hxx"
+#include "songFile.hxx"
+
+static constexpr unsigned int sampleRate = 48000;
+static constexpr size_t blockLength = 1024;
+static constexpr char octaveCount = 9;
+static constexpr unsigned short scalingInstruments = 1024;
+static constexpr unsigned short scalingOrders = 1024;
+static constexpr unsigned short scalingPatternsPerInstrument = 8;
+// The first few instruments get more patterns than one byte can count, so
+// the two-byte pattern indexes get saved, loaded and played too
+static constexpr unsigned short scalingWideInstruments = 4;
+static constexpr unsigned short scalingWidePatterns = 300;
+
+static const std::array<audioChannelType, 6> channelTypes = {
+    audioChannelType::null, audioChannelType::lfsr8, audioChannelType::lfsr14,
+    audioChannelType::pulse, audioChannelType::triangle, audioChannelType::sawtooth};
+static const std::array<const char *, 6> channelTypeNames = {
+    "null", "lfsr8", "lfsr14", "pulse", "triangle", "sawtooth"};
+
+static double minimumSeconds = 0.25;
+
+struct measurement {
+    size_t samples = 0;
+    double seconds = 0;
+    double rate() const { return seconds > 0 ? samples / seconds : 0; }
+};
+
+// Calls `pass` (which returns how many samples it made) until it's been
+// running for at least minimumSeconds
+template <typename F>
+static measurement measure(F pass) {
+    measurement m;
+    auto start = std::chrono::steady_clock::now();
+    do {
+        m.samples += pass();
+        m.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while(m.seconds < minimumSeconds);
+    return m;
+}
+
+static row noteRow(char note, char octave) {
+    row r;
+    r.feature = rowFeature::note;
+    r.note = 'A' + note;
+    r.octave = octave;
+    return r;
+}
+
+// Every note of an octave, a block each
+static measurement benchOctave(audioChannelType type, char octave) {
+    audioChannel channel(type);
+    channel.setSampleRate(sampleRate);
+    std::array<short, blockLength> block;
+    return measure([&]() {
+        for(char note = 0; note < 12; note++) {
+            channel.set_row(noteRow(note, octave));
+            channel.render(block.data(), block.size());
+        }
+        return 12 * block.size();
+    });
+}
+
+// A song with `instruments` instruments of every non-null type in turn, each
+// playing a note on every fourth row with some effects going. The order list
+// is `orders` long and cycles through `patterns` patterns per instrument. The
+// first `wideInstruments` cycle through `widePatterns` patterns instead.
+static void makeSong(song &target, unsigned short instruments, unsigned short orders = 2,
+                     unsigned short patterns = 2, unsigned short wideInstruments = 0,
+                     unsigned short widePatterns = 0) {
+    for(unsigned short o = 0; o < orders; o++) target.indexes.addRow();
+    for(unsigned short i = 0; i < instruments; i++) {
+        unsigned short patternCount = i < wideInstruments ? widePatterns : patterns;
+        target.instruments.add_inst(channelTypes.at(1 + i % (channelTypes.size() - 1)));
+        instrumentOrderTable *table = target.orders.at(target.orders.addTable());
+        target.indexes.addInst();
+        for(unsigned short o = 0; o < orders; o++) target.indexes.at(o)->set(i, o % patternCount);
+        for(unsigned short o = 0; o < patternCount; o++) {
+            order *pattern = table->at(table->add_order());
+            for(unsigned short r = 0; r < pattern->rowCount(); r += 4) {
+                row current = noteRow((i + r / 4) % 12, 2 + (i + o) % 5);
+                if(r % 8 == 0) current.effects.at(0) = {effectTypes::arpeggio, 0x4701};
+                if(r % 16 == 4) current.effects.at(1) = {effectTypes::pitchUp, 0x0040};
+                pattern->set(r, current);
+            }
+        }
+    }
+    target.instruments.setSampleRate(sampleRate);
+}
+
+static measurement benchSong(unsigned short instruments) {
+    song music;
+    makeSong(music, instruments);
+    player engine(music);
+    size_t length = engine.measure(sampleRate).length;
+    std::vector<short> out(length);
+    return measure([&]() {
+        engine.setPosition(0, 0);
+        engine.start(sampleRate);
+        engine.cue();
+        engine.mix(out.data(), length);
+        engine.stop();
+        return length;
+    });
+}
+
+struct scalingResult {
+    double saveSeconds = 0;
+    double loadSeconds = 0;
+    size_t songSamples = 0;
+    // Whether the reloaded song has the same pattern counts and order indexes
+    bool indexesMatch = false;
+    measurement playback;
+};
+
+// Every instrument's pattern count, then every order index, row by row
+static std::vector<unsigned short> indexTable(song &music) {
+    std::vector<unsigned short> table;
+    for(unsigned short i = 0; i < music.orders.tableCount(); i++) table.push_back(music.orders.at(i)->order_count());
+    for(unsigned short o = 0; o < music.indexes.rowCount(); o++) {
+        orderIndexRow *indexRow = music.indexes.at(o);
+        for(unsigned short i = 0; i < indexRow->instCount(); i++) table.push_back(indexRow->at(i));
+    }
+    return table;
+}
+
+// Saves and reloads the big song, checks its indexes came back the same, then
+// plays the reloaded copy for as long as one measurement takes. Playing starts
+// at the last order the wide instruments have a pattern of their own for.
+static scalingResult benchScaling() {
+    scalingResult result;
+    std::filesystem::path file = std::filesystem::temp_directory_path() / "chtracker-bench.cht";
+    std::vector<unsigned short> savedIndexes;
+    {
+        song music;
+        makeSong(music, scalingInstruments, scalingOrders, scalingPatternsPerInstrument, scalingWideInstruments,
+                 scalingWidePatterns);
+        savedIndexes = indexTable(music);
+        auto start = std::chrono::steady_clock::now();
+        if(saveSong(music, file) != 0) return result;
+        result.saveSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    song music;
+    char *errorText = nullptr;
+    auto start = std::chrono::steady_clock::now();
+    int failed = loadSong(music, file, errorText);
+    result.loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::filesystem::remove(file);
+    if(failed != 0) return result;
+    result.indexesMatch = indexTable(music) == savedIndexes;
+    music.instruments.setSampleRate(sampleRate);
+
+    player engine(music);
+    result.songSamples = engine.measure(sampleRate).length;
+    std::vector<short> out(blockLength);
+    engine.setPosition(scalingWidePatterns - 1, 0);
+    engine.start(sampleRate);
+    engine.cue();
+    result.playback = measure([&]() {
+        engine.mix(out.data(), out.size());
+        return out.size();
+    });
+    engine.stop();
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    if(argc > 1) minimumSeconds = std::atof(argv[1]);
+
+    fmt::print("{{\n");
+    fmt::print("  \"sampleRate\": {},\n", sampleRate);
+    fmt::print("  \"mixerKernels\": \"{}\",\n", mixer::kernelName());
+    fmt::print("  \"secondsPerMeasurement\": {},\n", minimumSeconds);
+    fmt::print("  \"channels\": [\n");
+    for(size_t t = 0; t < channelTypes.size(); t++) {
+        measurement total;
+        std::string octaves;
+        for(char octave = 0; octave < octaveCount; octave++) {
+            measurement m = benchOctave(channelTypes[t], octave);
+            total.samples += m.samples;
+            total.seconds += m.seconds;
+            octaves += fmt::format("{}{:.0f}", octave == 0 ? "" : ", ", m.rate());
+        }
+        fmt::print("    {{\"type\": \"{}\", \"samplesPerSecond\": {:.0f}, \"perOctave\": [{}]}}{}\n",
+                   channelTypeNames[t], total.rate(), octaves, t + 1 < channelTypes.size() ? "," : "");
+    }
+    fmt::print("  ],\n");
+    fmt::print("  \"songs\": [\n");
+    const std::array<unsigned char, 9> instrumentCounts = {1, 2, 4, 8, 16, 32, 64, 128, 255};
+    for(size_t i = 0; i < instrumentCounts.size(); i++) {
+        measurement m = benchSong(instrumentCounts[i]);
+        fmt::print("    {{\"instruments\": {}, \"samplesPerSecond\": {:.0f}, \"channelSamplesPerSecond\": {:.0f}}}{}\n",
+                   instrumentCounts[i], m.rate(), m.rate() * instrumentCounts[i],
+                   i + 1 < instrumentCounts.size() ? "," : "");
+    }
+    fmt::print("  ],\n");
+    scalingResult scaling = benchScaling();
+    double realtimeFactor = scaling.playback.rate() / sampleRate;
+    bool realtime = realtimeFactor >= 1.0;
+    fmt::print("  \"scaling\": {{\"instruments\": {}, \"orders\": {}, \"patternsPerInstrument\": {}, "
+               "\"wideInstruments\": {}, \"widePatterns\": {}, \"songSeconds\": {:.1f}, \"saveSeconds\": {:.3f}, "
+               "\"loadSeconds\": {:.3f}, \"indexesMatch\": {}, \"realtimeFactor\": {:.2f}, \"realtime\": {}}}\n",
+               scalingInstruments, scalingOrders, scalingPatternsPerInstrument, scalingWideInstruments,
+               scalingWidePatterns, double(scaling.songSamples) / sampleRate, scaling.saveSeconds, scaling.loadSeconds,
+               scaling.indexesMatch, realtimeFactor, realtime);
+    fmt::print("}}\n");
+    if(!scaling.indexesMatch) {
+        fmt::print(stderr, "The scaling song's order indexes changed when it was saved and loaded\n");
+        return 1;
+    }
+    if(!realtime) {
+        fmt::print(stderr, "The scaling song played at {:.2f}x real time, below 1x\n", realtimeFactor);
+        return 1;
+    }
+    return 0;
+}
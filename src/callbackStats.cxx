@@ -0,0 +1,85 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/callbackStats.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+#include <algorithm>
+#include <stdexcept>
+#include "callbackStats.hxx"
+
+// There's only the one writer, so plain loads and stores are enough for
+// everything but the histogram, which readers add up while it's written.
+void callbackStats::record(uint64_t elapsed, uint64_t deadline) {
+    if(resetRequested.exchange(false, std::memory_order_acquire)) {
+        count.store(0, std::memory_order_relaxed);
+        overruns.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        minimum.store(UINT64_MAX, std::memory_order_relaxed);
+        maximum.store(0, std::memory_order_relaxed);
+        for(std::atomic<uint32_t> &bucket : histogram) bucket.store(0, std::memory_order_relaxed);
+    }
+    total.store(total.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+    if(elapsed < minimum.load(std::memory_order_relaxed)) minimum.store(elapsed, std::memory_order_relaxed);
+    if(elapsed > maximum.load(std::memory_order_relaxed)) maximum.store(elapsed, std::memory_order_relaxed);
+    if(elapsed * 100 > deadline * overrunPercent.load(std::memory_order_relaxed)) {
+        overruns.store(overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    lastDeadline.store(deadline, std::memory_order_relaxed);
+    histogram[std::min<uint64_t>(elapsed / bucketWidth, bucketCount - 1)].fetch_add(1, std::memory_order_relaxed);
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void callbackStats::reset() {
+    resetRequested.store(true, std::memory_order_release);
+}
+
+void callbackStats::setOverrunPercent(unsigned int percent) {
+    if(percent == 0) throw std::invalid_argument("callbackStats::setOverrunPercent : must be above 0");
+    overrunPercent.store(percent, std::memory_order_relaxed);
+}
+
+unsigned int callbackStats::getOverrunPercent() const {
+    return overrunPercent.load(std::memory_order_relaxed);
+}
+
+// Read while the audio thread records, so the numbers can be a callback apart
+// from each other
+callbackTimings callbackStats::summary() const {
+    callbackTimings timings;
+    timings.count = count.load(std::memory_order_acquire);
+    timings.overrunFraction = overrunPercent.load(std::memory_order_relaxed) / 100.0;
+    timings.deadline = lastDeadline.load(std::memory_order_relaxed) / 1000.0;
+    if(timings.count == 0) return timings;
+    timings.overruns = overruns.load(std::memory_order_relaxed);
+    timings.min = minimum.load(std::memory_order_relaxed) / 1000.0;
+    timings.max = maximum.load(std::memory_order_relaxed) / 1000.0;
+    timings.average = total.load(std::memory_order_relaxed) / 1000.0 / timings.count;
+
+    uint64_t histogramCount = 0;
+    for(const std::atomic<uint32_t> &bucket : histogram) histogramCount += bucket.load(std::memory_order_relaxed);
+    uint64_t seen = 0;
+    for(size_t i = 0; i < bucketCount; i++) {
+        seen += histogram[i].load(std::memory_order_relaxed);
+        if(seen * 100 >= histogramCount * 99) {
+            // The top of the bucket, but no more than the slowest callback
+            timings.p99 = std::min(static_cast<double>((i + 1) * bucketWidth) / 1000.0, timings.max);
+            break;
+        }
+    }
+    return timings;
+}
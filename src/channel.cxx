@@ -18,6 +18,8 @@
   Chase Taylor @ creset200@gmail.com
 */
 
+#include <algorithm>
+#include <array>
 #include <climits>
 #include <cmath>
 #include <stdexcept>
@@ -29,10 +31,44 @@ namespace audio {
     double audioChannelFrequency = 48000.0;
 }
 
+// Note frequency table
+
+// Rows store notes 0-15, octaves 0-15 and arpeggios add up to 15 semitones,
+// so every pitch a channel can play is one of these.
+constexpr size_t noteFrequencyCount = 16 + 15 + 12 * 15;
+
+constexpr double semitoneRatio() {
+    // Newton's method for x^12 = 2; std::pow isn't constexpr
+    double x = 1.06;
+    for(int i = 0; i < 8; i++) {
+        double x11 = 1;
+        for(int j = 0; j < 11; j++) x11 *= x;
+        x -= (x11 * x - 2) / (12 * x11);
+    }
+    return x;
+}
+
+constexpr std::array<double, noteFrequencyCount> makeNoteFrequencies() {
+    std::array<double, 12> semitones = {};
+    semitones[0] = 440;
+    for(int i = 1; i < 12; i++) semitones[i] = semitones[i-1] * semitoneRatio();
+    std::array<double, noteFrequencyCount> table = {};
+    for(size_t i = 0; i < noteFrequencyCount; i++) {
+        // Semitone 48 is A-4 (440Hz); octaves are exact powers of two
+        int octave = (static_cast<int>(i) / 12) - 4;
+        double hz = semitones[i % 12];
+        for(; octave > 0; octave--) hz *= 2;
+        for(; octave < 0; octave++) hz /= 2;
+        table[i] = hz;
+    }
+    return table;
+}
+
+static constexpr std::array<double, noteFrequencyCount> noteFrequencies = makeNoteFrequencies();
+
 audioChannel::audioChannel(audioChannelType type): 
-    noiseLFSR(1), 
-    status({rowFeature::empty, 'A',
-        4, 255, std::vector<effect>(4)}),
+    noisePosition(0), 
+    status({rowFeature::empty, 'A', 4, 255, {}}),
     channelType(type), effects({ 
         .pitchOffset=0, 
         .volumeOffset=0, 
@@ -41,7 +77,9 @@ audioChannel::audioChannel(audioChannelType type):
         .arpeggioIndex = 0,
         .arpeggioSubIndex = 0,
         .arpeggioSpeed = 0
-    }), phase(0) { }
+    }), phaseAccumulator(0), sampleRate(audio::audioChannelFrequency) {
+    refresh();
+}
 
 void audioChannel::cycle_type() {
     switch(channelType) {
@@ -52,13 +90,14 @@ void audioChannel::cycle_type() {
         case audioChannelType::triangle: channelType = audioChannelType::sawtooth; break;
         case audioChannelType::sawtooth: channelType = audioChannelType::lfsr8; break;
     }
+    refresh();
 }
 
 audioChannelType audioChannel::get_type() {
     return channelType;
 }
 
-void audioChannel::set_row(row r) {
+void audioChannel::set_row(const row &r) {
     if(r.feature != rowFeature::empty) {
         for(unsigned char i = 0; i < 4; i++) {
             effect& e = status.effects.at(i);
@@ -77,14 +116,14 @@ void audioChannel::set_row(row r) {
                 return;
             }
             case rowFeature::note_cut: {
-                phase = 0;
-                noiseLFSR = 1;
+                phaseAccumulator = 0;
+                noisePosition = 0;
                 status.feature = rowFeature::empty;
                 status.volume = 0;
                 break;
             }
             case rowFeature::note: {
-                phase = 0;
+                phaseAccumulator = 0;
                 status.feature = rowFeature::note;
                 status.note = r.note;
                 status.octave = r.octave;
@@ -93,8 +132,8 @@ void audioChannel::set_row(row r) {
             }
         }
     }
-    for(unsigned char i = 0; i < r.effects.size() && i < 4; i++) {
-        effect& rowEffect = r.effects.at(i);
+    for(unsigned char i = 0; i < r.effects.size(); i++) {
+        const effect& rowEffect = r.effects[i];
         effect& statusEffect = status.effects.at(i);
 
         if(rowEffect.type == effectTypes::null) continue;
@@ -111,13 +150,7 @@ void audioChannel::set_row(row r) {
         statusEffect.type = rowEffect.type;
         statusEffect.effect = rowEffect.effect;
     }
-}
-
-void audioChannel::noiseLFSRTick(char width) {
-    unsigned char tap = (noiseLFSR&1)^((noiseLFSR>>1)&1);
-    noiseLFSR>>=1;
-    noiseLFSR|=tap<<width;
-    if(noiseLFSR==0) noiseLFSR = 1;
+    refresh();
 }
 
 void audioChannel::applyFx() {
@@ -159,78 +192,193 @@ void audioChannel::applyFx() {
             }
         }
     }
+    refresh();
 }
 
 void audioChannel::applyArpeggio() {
     if(++effects.arpeggioSubIndex >= effects.arpeggioSpeed) {
         effects.arpeggioSubIndex=0;
         effects.arpeggioIndex=(effects.arpeggioIndex+1)&3;
+        refresh();
     }
 }
 
-short audioChannel::gen() {
-    if(status.feature == rowFeature::empty) return 0;
-    float Hz = std::pow(2,(status.note-'A'-48+(effects.arpeggioIndex==0?0:effects.arpeggio[effects.arpeggioIndex-1]))/12.0+status.octave)*440;
+// LFSR sequence tables
+
+// Seeded with 1, the registers repeat after this many ticks. The 8 bit
+// register's taps don't make a maximal-length LFSR, hence the short period.
+constexpr size_t lfsr8Period = 73;
+constexpr size_t lfsr14Period = 32767;
+
+// The whole output sequence (bit 0 of each state), one bit per tick
+template <size_t period>
+constexpr std::array<uint32_t, (period + 31) / 32> makeLFSRSequence(int width) {
+    std::array<uint32_t, (period + 31) / 32> bits = {};
+    unsigned short lfsr = 1;
+    for(size_t i = 0; i < period; i++) {
+        bits[i / 32] |= static_cast<uint32_t>(lfsr & 1) << (i % 32);
+        unsigned char tap = (lfsr&1)^((lfsr>>1)&1);
+        lfsr>>=1;
+        lfsr|=tap<<width;
+    }
+    return bits;
+}
+
+static constexpr auto lfsr8Sequence = makeLFSRSequence<lfsr8Period>(8);
+static constexpr auto lfsr14Sequence = makeLFSRSequence<lfsr14Period>(14);
+
+// However many times the register ticks in a sample, it's one add and a
+// table lookup. Returns the new position.
+static uint32_t renderNoise(short *out, size_t frames, const uint32_t *sequence,
+                            uint32_t period, uint32_t position, uint32_t &acc,
+                            uint32_t step, uint32_t ticksPerSample, short volume) {
+    for(size_t i = 0; i < frames; i++) {
+        acc += step;
+        position += ticksPerSample + (acc < step ? 1 : 0);
+        if(position >= period) position %= period;
+        out[i] = (sequence[position / 32] >> (position % 32)) & 1 ? volume : -volume;
+    }
+    return position;
+}
+
+void audioChannel::refresh() {
+    silent = true;
+    if(status.feature == rowFeature::empty) return;
+    int semitone = (status.note-'A')+status.octave*12+(effects.arpeggioIndex==0?0:effects.arpeggio[effects.arpeggioIndex-1]);
+    // A note below 'A' or past the table is a bad row; better silent than
+    // the highest pitch there is
+    if(semitone < 0 || semitone >= static_cast<int>(noteFrequencyCount)) return;
+    float Hz = noteFrequencies[semitone];
     Hz += effects.pitchOffset/512.0;
-    if(Hz<=0) return 0; // DC or reverse; we don't want reverse!
-    short final_volume = static_cast<short>(std::min(255.0,std::max(0.0,status.volume * (255.0 + effects.volumeOffset/2048.0) / 255.0))) * 128;
-    float change = 1.0/audio::audioChannelFrequency*Hz;
-    if(channelType == audioChannelType::lfsr8) phase+=change;
-    else if(channelType == audioChannelType::lfsr14) phase+=change;
-    else phase=static_cast<float>(std::fmod(phase+change,1.0));
+    if(Hz<=0) return; // DC or reverse; we don't want reverse!
+    finalVolume = static_cast<short>(std::min(255.0,std::max(0.0,status.volume * (255.0 + effects.volumeOffset/2048.0) / 255.0))) * 128;
+    double phaseIncrement = 1.0/sampleRate*Hz;
+    double wholeCycles = std::floor(phaseIncrement);
+    // Only the fraction of a cycle per sample matters to tonal channels;
+    // the LFSRs also tick once for every whole cycle.
+    phaseStep = static_cast<uint32_t>((phaseIncrement - wholeCycles) * 4294967296.0);
+    noiseTicksPerSample = static_cast<uint32_t>(wholeCycles);
+    silent = false;
+}
+
+void audioChannel::setSampleRate(double rate) {
+    sampleRate = rate;
+    refresh();
+}
+
+bool audioChannel::isActive() const {
+    return !silent && channelType != audioChannelType::null;
+}
+
+short audioChannel::gen() {
+    short sample;
+    render(&sample, 1);
+    return sample;
+}
+
+void audioChannel::render(short *out, size_t frames) {
+    if(silent || channelType == audioChannelType::null) {
+        std::fill_n(out, frames, 0);
+        return;
+    }
+    // Locals so the compiler doesn't have to assume `out` aliases them
+    const short volume = finalVolume;
+    const unsigned short variation = effects.instrumentVariation;
+    const uint32_t step = phaseStep;
+    uint32_t acc = phaseAccumulator;
     switch(channelType) {
-        case audioChannelType::null: return 0;
-        case audioChannelType::pulse: return static_cast<unsigned short>(phase*USHRT_MAX)>effects.instrumentVariation?final_volume:-final_volume;
-        case audioChannelType::lfsr8: {
-            while(phase>1) {
-                phase-=1;
-                noiseLFSRTick(8);
+        case audioChannelType::null: break;
+        case audioChannelType::pulse: {
+            for(size_t i = 0; i < frames; i++) {
+                acc += step;
+                out[i] = (acc >> 16) > variation ? volume : -volume;
             }
-            return (noiseLFSR&1)?final_volume:-final_volume;
+            break;
+        }
+        case audioChannelType::lfsr8: {
+            noisePosition = renderNoise(out, frames, lfsr8Sequence.data(), lfsr8Period,
+                noisePosition, acc, step, noiseTicksPerSample, volume);
+            break;
         }
         case audioChannelType::lfsr14: {
-            while(phase>1) {
-                phase-=1;
-                noiseLFSRTick(14);
+            noisePosition = renderNoise(out, frames, lfsr14Sequence.data(), lfsr14Period,
+                noisePosition, acc, step, noiseTicksPerSample, volume);
+            break;
+        }
+        case audioChannelType::triangle: {
+            // |phase * (2 + variation/16384) - 1| folded into one cycle, in
+            // 16.16 fixed point; variation bends it from a triangle into a
+            // folded wave.
+            const uint64_t slope = 32768 + variation;
+            for(size_t i = 0; i < frames; i++) {
+                acc += step;
+                int64_t x = static_cast<int64_t>((acc * slope) >> 30) - 65536;
+                int32_t wave = static_cast<int32_t>((x < 0 ? -x : x) & 0xFFFF) - 32768;
+                out[i] = static_cast<short>((wave * volume) >> 15);
             }
-            return (noiseLFSR&1)?final_volume:-final_volume;
+            break;
+        }
+        case audioChannelType::sawtooth: {
+            // Mixes bits of the saw and of a saw at 1.5x its frequency
+            for(size_t i = 0; i < frames; i++) {
+                acc += step;
+                uint32_t saw = acc >> 16;
+                uint32_t fast = (acc + (acc >> 1)) >> 16;
+                int32_t wave = static_cast<int32_t>((saw & ~variation) ^ (fast & variation)) - 32768;
+                out[i] = static_cast<short>((wave * volume) >> 15);
+            }
+            break;
         }
-        case audioChannelType::triangle: return static_cast<short>((std::fmod(std::abs(phase*(effects.instrumentVariation/16384.0+2.0)-1.0),1.0)-0.5)*final_volume*2.0);
-        case audioChannelType::sawtooth: return static_cast<short>(
-            (static_cast<float>(
-                (static_cast<unsigned short>(phase*USHRT_MAX)&~effects.instrumentVariation)^
-                (static_cast<unsigned short>(std::fmod(phase*1.5,1.0)*USHRT_MAX)&effects.instrumentVariation)
-            )/USHRT_MAX-0.5)*final_volume*2.0
-        );
     }
-    return 0;
+    phaseAccumulator = acc;
 }
 
 // instrumentStorage
 
 instrumentStorage::instrumentStorage() {}
-unsigned char instrumentStorage::add_inst(audioChannelType type) {
-    instruments.push_back(audioChannel(type));
+unsigned short instrumentStorage::add_inst(audioChannelType type) {
+    if(instruments.size() >= 0xFFFF) throw std::length_error("instrumentStorage::add_inst");
+    instruments.emplace_back(type);
+    refreshVoice(instruments.size()-1);
     return instruments.size()-1;
 }
-unsigned char instrumentStorage::inst_count() {
+unsigned short instrumentStorage::inst_count() const {
     return instruments.size();
 }
-void instrumentStorage::remove_inst(unsigned char idx) {
+void instrumentStorage::remove_inst(unsigned short idx) {
     if(idx>=inst_count()) throw std::out_of_range("instrumentStorage::remove_inst");
-    
-    for(unsigned char i = inst_count()-1; i>idx; i--) {
-        audioChannel inst = instruments.back();
-        instruments.pop_back();
-        erase_instruments.push_back(inst);
-    }
-    instruments.pop_back();
-    while(!erase_instruments.empty()) {
-        audioChannel inst = erase_instruments.back();
-        erase_instruments.pop_back();
-        instruments.push_back(inst);
-    }
+    instruments.erase(instruments.begin() + idx);
+    refreshAllVoices();
 }
-audioChannel* instrumentStorage::at(unsigned char idx) {
+audioChannel* instrumentStorage::at(unsigned short idx) {
     return &instruments.at(idx);
 }
+void instrumentStorage::setSampleRate(double rate) {
+    for(size_t i = 0; i < instruments.size(); i++) instruments[i].setSampleRate(rate);
+    refreshAllVoices();
+}
+// Each voice is its own bit of a shared word, hence fetch_or and fetch_and
+void instrumentStorage::refreshVoice(unsigned short idx) {
+    if(idx>=inst_count()) throw std::out_of_range("instrumentStorage::refreshVoice");
+    uint64_t bit = uint64_t(1) << (idx % 64);
+    if(instruments[idx].isActive()) activeVoices[idx / 64].fetch_or(bit, std::memory_order_relaxed);
+    else activeVoices[idx / 64].fetch_and(~bit, std::memory_order_relaxed);
+}
+void instrumentStorage::refreshAllVoices() {
+    for(std::atomic<uint64_t> &word : activeVoices) word.store(0, std::memory_order_relaxed);
+    for(unsigned short i = 0; i < inst_count(); i++) refreshVoice(i);
+}
+bool instrumentStorage::isActive(unsigned short idx) const {
+    return activeVoices[idx / 64].load(std::memory_order_relaxed) >> (idx % 64) & 1;
+}
+uint64_t instrumentStorage::activeWord(unsigned short word) const {
+    return activeVoices.at(word).load(std::memory_order_relaxed);
+}
+unsigned short instrumentStorage::activeWordCount() const {
+    return (instruments.size() + 63) / 64;
+}
+unsigned short instrumentStorage::activeCount() const {
+    unsigned short count = 0;
+    for(unsigned short word = 0; word < activeWordCount(); word++) count += __builtin_popcountll(activeWord(word));
+    return count;
+}
@@ -41,27 +41,41 @@
 #include <SDL2/SDL_video.h>
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <climits>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <ostream>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <strings.h>
+#include <thread>
 #include <vector>
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <unistd.h>
 #endif
 
+#include "callbackStats.hxx"
 #include "channel.hxx"
 #include "log.hxx"
 #include "main.h"
+#include "mixer.hxx"
 #include "order.hxx"
-#include "timer.hxx"
+#include "player.hxx"
+#include "render.hxx"
+#include "song.hxx"
+#include "songFile.hxx"
 
 /**************************************
  *                                    *
@@ -96,31 +110,28 @@ using std::filesystem::path;
 
 namespace audio {
 unsigned long /******/ time = 0;
-unsigned char /******/ row = -1;
-unsigned short /*****/ pattern = 0;
 bool /***************/ isPlaying = false;
 bool /***************/ freeze = false;
 bool /***************/ isFrozen = true;
-unsigned short /*****/ tempo = 960;
 SDL_AudioDeviceID /**/ deviceID = 0;
 SDL_AudioSpec /******/ spec;
 bool /***************/ errorIsPresent = false;
+unsigned int /*******/ renderThreads = 0; // 0 is one per core
+bool /***************/ renderStems = false;
+callbackStats /******/ callbackTiming;
 } // namespace audio
 
 /**************
  * Music data *
  **************/
 
-orderStorage /*******/ orders(32);
-orderIndexStorage /**/ indexes;
-unsigned short /*****/ patternLength = 32;
+song /***************/ currentSong;
 
 /***********
  * Systems *
  ***********/
 
-timerHandler /**/ timerSystem;
-instrumentStorage instrumentSystem;
+player /*********/ livePlayer(currentSong);
 
 /*********
  * (G)UI *
@@ -153,6 +164,13 @@ string /**/ renderMenu_fileName = "render.wav";
 path /****/ executableAbsolutePath = "";
 path /****/ documentationDirectory = "./doc";
 bool /****/ global_unsavedChanges = false;
+std::unique_ptr<renderJob> backgroundRender;
+path /****/ headlessRenderInput = "";
+path /****/ headlessRenderOutput = "";
+path /****/ batchRenderDirectory = "";
+path /****/ goldenCheckDirectory = "";
+bool /****/ goldenUpdate = false;
+bool /****/ goldenTimeReportOnly = false;
 
 /*****************************
  *                           *
@@ -171,55 +189,6 @@ void quit(int code = 0) {
   exit(code);
 }
 
-/***********************************
- * Data functions (for wav header) *
- ***********************************/
-
-void write32LE(unsigned char *buffer, unsigned int a, size_t &bufferIdx) {
-  buffer[bufferIdx++] = (static_cast<unsigned char>(a & 255));
-  buffer[bufferIdx++] = (static_cast<unsigned char>(a >> 8 & 255));
-  buffer[bufferIdx++] = (static_cast<unsigned char>(a >> 16 & 255));
-  buffer[bufferIdx++] = (static_cast<unsigned char>(a >> 24 & 255));
-}
-
-void write16LE(unsigned char *buffer, unsigned short a, size_t &bufferIdx) {
-  buffer[bufferIdx++] = (static_cast<unsigned char>(a & 255));
-  buffer[bufferIdx++] = (static_cast<unsigned char>(a >> 8 & 255));
-}
-
-/***********************
- * Audio timer handler *
- ***********************/
-
-void audioTickTimers() {
-  timerSystem.tick();
-  if (timerSystem.isComplete("row")) {
-    if (audio::row >= orders.at(0)->at(0)->rowCount() - 1) {
-      audio::row = 0;
-      if (audio::pattern >= indexes.rowCount() - 1) audio::pattern = 0;
-      else audio::pattern++;
-    } else audio::row++;
-    timerSystem.resetTimer("row", 48000 * 60 / audio::tempo);
-    for (unsigned char i = 0; i < instrumentSystem.inst_count(); i++) {
-      unsigned char patternIndex = indexes.at(audio::pattern)->at(i);
-      row *currentRow = orders.at(i)->at(patternIndex)->at(audio::row);
-      instrumentSystem.at(i)->set_row(*currentRow);
-    }
-  }
-  if (timerSystem.isComplete("effect")) {
-    for (unsigned char i = 0; i < instrumentSystem.inst_count(); i++) {
-      instrumentSystem.at(i)->applyFx();
-    }
-    timerSystem.resetTimer("effect", 375 * 960 / audio::tempo);
-  }
-  if (timerSystem.isComplete("arpeggio")) {
-    for (unsigned char i = 0; i < instrumentSystem.inst_count(); i++) {
-      instrumentSystem.at(i)->applyArpeggio();
-    }
-    timerSystem.resetTimer("arpeggio", 1500 * 960 / audio::tempo);
-  }
-}
-
 /*************************
  * Channel name function *
  *************************/
@@ -284,412 +253,102 @@ char *getTypeName(audioChannelType type, bool short_name) {
  * File functions *
  ******************/
 
-int saveFile(path path) {
-  cmd::log::notice("Saving to file {}", path.string());
-  std::ofstream file(path, std::ios::out | std::ios::binary);
-  if (!file || !file.is_open()) {
-    cmd::log::error("Couldn't open the file");
-    return 1;
-  }
-  unsigned char *buffer = new unsigned char[256];
-  // Version
-  for (int i = 0; i < 9; i++) {
-    buffer[i] = "CHTRACKER"[i];
-  }
-  buffer[9] = global_majorVersion;
-  buffer[10] = global_minorVersion;
-  buffer[11] = global_patchVersion;
-  buffer[12] = global_prereleaseVersion;
-
-  buffer[13] = static_cast<unsigned char>(audio::tempo >> 8);
-  buffer[14] = static_cast<unsigned char>(audio::tempo & 255);
-
-  buffer[15] = static_cast<unsigned char>(patternLength >> 8);
-  buffer[16] = static_cast<unsigned char>(patternLength & 255);
-
-  {
-    unsigned short orderCount = indexes.rowCount();
-    buffer[17] = static_cast<unsigned char>(orderCount >> 8);
-    buffer[18] = static_cast<unsigned char>(orderCount & 255);
-  }
-  buffer[19] = instrumentSystem.inst_count();
-
-  // Fill unused space with FF
-  for (int i = 20; i < 256; i++) {
-    buffer[i] = 0xff;
-  }
-  file.write(reinterpret_cast<const char *>(buffer), 256);
-  cmd::log::debug("Wrote header");
-  delete[] buffer;
-  for (int i = 0; i < instrumentSystem.inst_count(); i++) {
-    buffer = new unsigned char[8];
-    buffer[0] = static_cast<unsigned char>(instrumentSystem.at(i)->get_type());
-    buffer[1] = orders.at(i)->order_count();
-    buffer[2] = 0xff;
-    buffer[3] = 0xff;
-    buffer[4] = 0xff;
-    buffer[5] = 0xff;
-    buffer[6] = 0xff;
-    buffer[7] = 0xff;
-    file.write(reinterpret_cast<const char *>(buffer), 8);
-    delete[] buffer;
-  }
-  cmd::log::debug("Wrote instrument table");
-  {
-    for (unsigned short orderRowIndex = 0; orderRowIndex < indexes.rowCount();
-         orderRowIndex++) {
-      buffer = new unsigned char[orders.tableCount()];
-      try {
-        for (unsigned char orderIndex = 0;
-             orderIndex < indexes.at(orderRowIndex)->instCount();
-             orderIndex++) {
-          try {
-            buffer[orderIndex] = indexes.at(orderRowIndex)->at(orderIndex);
-          } catch (std::out_of_range &) {
-            cmd::log::warning("OOR error saving an order index");
-            buffer[orderIndex] = 0;
-          }
-        }
-      } catch (std::out_of_range &) {
-        cmd::log::warning("OOR error");
-        continue;
-      }
-      try {
-        file.write(reinterpret_cast<const char *>(buffer),
-                   indexes.at(orderRowIndex)->instCount());
-      } catch (std::out_of_range &) {
-        cmd::log::debug(
-
-            "OOR error writing data using index-based instrument count");
-        file.write(reinterpret_cast<const char *>(buffer), orders.tableCount());
-      }
-      delete[] buffer;
-    }
-    cmd::log::debug("Wrote index data");
-    for (unsigned char tableIdx = 0; tableIdx < orders.tableCount();
-         tableIdx++) {
-      instrumentOrderTable *table = orders.at(tableIdx);
-      for (unsigned char orderIdx = 0; orderIdx < table->order_count();
-           orderIdx++) {
-        order *o = table->at(orderIdx);
-        for (unsigned short rowIdx = 0; rowIdx < o->rowCount(); rowIdx++) {
-          row *r = o->at(rowIdx);
-          buffer = new unsigned char[32];
-          switch (r->feature) {
-          case rowFeature::empty:
-            buffer[0] = 0;
-            break;
-          case rowFeature::note:
-            buffer[0] = 1;
-            break;
-          case rowFeature::note_cut:
-            buffer[0] = 2;
-            break;
-          }
-          buffer[1] = ((r->note - 'A') & 15) << 4;
-          buffer[1] |= r->octave & 15;
-          buffer[2] = r->volume;
-          for (size_t i = 0; i < r->effects.size() && i < 4; i++) {
-            const effect &e = r->effects.at(i);
-            buffer[3 + (i * 3)] = static_cast<unsigned char>(e.type);
-            buffer[4 + (i * 3)] = e.effect >> 8 & 255;
-            buffer[5 + (i * 3)] = e.effect & 255;
-          }
-          for (int i = 15; i < 32; i++) {
-            buffer[i] = 0xff;
-          }
-          file.write(reinterpret_cast<const char *>(buffer), 32);
-          delete[] buffer;
-        }
-      }
-      cmd::log::debug("Wrote order table for instrument {}", tableIdx);
-    }
-    cmd::log::debug("Wrote order storage");
-  }
-  file.close();
-  cmd::log::debug("Saved successfully");
-  return 0;
-}
+int saveFile(path path) { return saveSong(currentSong, path); }
 
 int loadFile(path filePath) {
-  if (timerSystem.hasTimer("row"))
-    timerSystem.removeTimer("row");
-  if (timerSystem.hasTimer("effect"))
-    timerSystem.removeTimer("effect");
-  if (timerSystem.hasTimer("arpeggio"))
-    timerSystem.removeTimer("arpeggio");
-  audio::row = 0;
-  audio::pattern = 0;
+  livePlayer.stop();
+  livePlayer.setPosition(0, 0);
   audio::time = 0;
   audio::isPlaying = false;
-  cmd::log::notice("Loading file {}", filePath.string());
-  std::ifstream file(filePath, std::ios::in | std::ios::binary);
-  if (!file || !file.is_open()) {
-    cmd::log::error("Couldn't open the file");
-    return 1;
-  }
-  unsigned char *buffer = new unsigned char[256];
-  file.read(reinterpret_cast<char *>(buffer), 256);
-  for (int i = 0; i < 9; i++) {
-    if (buffer[i] != "CHTRACKER"[i]) {
-      fileMenu_errorText = const_cast<char *>("Not a chTRACKER file");
-      cmd::log::error(fileMenu_errorText);
-      cmd::log::debug("Mismatch on letter {}", i);
-      delete[] buffer;
-      file.close();
-      return 1;
-    }
-  }
-  if (buffer[12] != 0)
-    cmd::log::debug("File version {}.{}.{}.{}", static_cast<int>(buffer[9]),
-                    static_cast<int>(buffer[10]), static_cast<int>(buffer[11]),
-                    static_cast<char>('A' + buffer[12] - 1));
-  else
-    cmd::log::debug("File version {}.{}.{}", static_cast<int>(buffer[9]),
-                    static_cast<int>(buffer[10]), static_cast<int>(buffer[11]));
-  if (buffer[9] != global_majorVersion) {
-    fileMenu_errorText = const_cast<char *>("Major version mismatch");
-    cmd::log::error("Major verion mismatch, expected {} and got {}",
-                    global_majorVersion, buffer[9]);
-    delete[] buffer;
-    file.close();
+  return loadSong(currentSong, filePath, fileMenu_errorText);
+}
+
+int renderSong(song &source, path path, unsigned int threads, bool stems) {
+  cmd::log::notice("Rendering to file {}", path.string());
+  if (source.orders.tableCount() < 1) {
+    cmd::log::notice("Refusing to render without instruments");
     return 1;
   }
-  if (buffer[10] > global_minorVersion) {
-    fileMenu_errorText = const_cast<char *>("Newer minor version");
-    cmd::log::error("Newer minor verion, expected {} and got {}",
-                    global_minorVersion, buffer[10]);
-    delete[] buffer;
-    file.close();
+  renderJob job(source, path, threads, stems);
+  cmd::log::debug("The song is {} samples long", job.getTiming().length);
+  if (job.render() != renderStatus::done) {
+    cmd::log::error("{}", job.getError());
     return 1;
   }
-  if (buffer[11] > global_patchVersion && buffer[10] == global_minorVersion) {
-    cmd::log::warning("Newer patch version, found {}", buffer[11]);
-  }
-  if (buffer[12] > 0 && global_prereleaseVersion == 0) {
-    cmd::log::warning("Opening prerelease file on non-prerelease version");
-  }
-  unsigned short local_rowsPerMinute = audio::tempo =
-      static_cast<unsigned short>(buffer[13]) << 8 |
-      static_cast<unsigned short>(buffer[14]);
-  unsigned short local_rowsPerPattern = patternLength =
-      static_cast<unsigned short>(buffer[15]) << 8 |
-      static_cast<unsigned short>(buffer[16]);
-  unsigned short local_orderCount = static_cast<unsigned short>(buffer[17])
-                                        << 8 |
-                                    static_cast<unsigned short>(buffer[18]);
-  unsigned char local_instrumentCount = buffer[19];
-  delete[] buffer;
-  cmd::log::debug("Tempo {}, {} rows per pattern, {} orders and {} instruments",
-                  local_rowsPerMinute, local_rowsPerPattern, local_orderCount,
-                  local_instrumentCount);
-  std::vector<unsigned char> instrumentOrderCounts(0);
-
-  buffer = new unsigned char[local_instrumentCount * 8];
-  file.read(reinterpret_cast<char *>(buffer), local_instrumentCount * 8);
-  cmd::log::debug("Creating instruments");
-  while (instrumentSystem.inst_count() > 0)
-    instrumentSystem.remove_inst(instrumentSystem.inst_count() - 1);
-  for (unsigned char instrumentIdx = 0; instrumentIdx < local_instrumentCount;
-       instrumentIdx++) {
-    unsigned char *i = buffer + (instrumentIdx * 8);
-    instrumentSystem.add_inst(static_cast<audioChannelType>(i[0]));
-    instrumentOrderCounts.push_back(i[1]);
-  }
-  delete[] buffer;
-
-  buffer = new unsigned char[local_instrumentCount * local_orderCount];
-  file.read(reinterpret_cast<char *>(buffer),
-            local_instrumentCount * local_orderCount);
-  cmd::log::debug("Reading index data");
-  while (indexes.rowCount() > 0)
-    indexes.removeRow(indexes.rowCount() - 1);
-  for (unsigned short orderIdx = 0; orderIdx < local_orderCount; orderIdx++) {
-    orderIndexRow *r = indexes.at(indexes.addRow());
-    while (r->instCount() > 0)
-      r->removeInst(r->instCount() - 1);
-    unsigned char *i = buffer + (orderIdx * local_instrumentCount);
-    for (unsigned char instrumentIdx = 0; instrumentIdx < local_instrumentCount;
-         instrumentIdx++) {
-      r->set(r->addInst(), i[instrumentIdx]);
-    }
-  }
-  delete[] buffer;
-
-  orders.setRowCount(local_rowsPerPattern);
-  cmd::log::debug("Reading order data");
-  while (orders.tableCount() > 0)
-    orders.removeTable(orders.tableCount() - 1);
-  for (unsigned char tableIdx = 0; tableIdx < local_instrumentCount;
-       tableIdx++) {
-    buffer = new unsigned char[instrumentOrderCounts.at(tableIdx) *
-                               local_rowsPerPattern * 32];
-    file.read(reinterpret_cast<char *>(buffer),
-              instrumentOrderCounts.at(tableIdx) * local_rowsPerPattern * 32);
-    instrumentOrderTable *table = orders.at(orders.addTable());
-    table->set_row_count(local_rowsPerPattern);
-    for (unsigned char orderIdx = 0;
-         orderIdx < instrumentOrderCounts.at(tableIdx); orderIdx++) {
-      unsigned char *oFile = buffer + (orderIdx * local_rowsPerPattern * 32);
-      order *oInternal = table->at(table->add_order());
-      oInternal->setRowCount(local_rowsPerPattern);
-      for (unsigned short rowIdx = 0; rowIdx < local_rowsPerPattern; rowIdx++) {
-        unsigned char *rFile = oFile + (rowIdx * 32);
-        row *rInternal = oInternal->at(rowIdx);
-        //     switch(r->feature) {
-        //         case rowFeature::empty:     buffer[0] = 0; break;
-        //         case rowFeature::note:      buffer[0] = 1; break;
-        //         case rowFeature::note_cut:  buffer[0] = 2; break;
-        //     }
-        switch (rFile[0]) {
-        case 0:
-        default:
-          rInternal->feature = rowFeature::empty;
-          break;
-        case 1:
-          rInternal->feature = rowFeature::note;
-          break;
-        case 2:
-          rInternal->feature = rowFeature::note_cut;
-          break;
-        }
-        rInternal->note = (rFile[1] >> 4 & 15) + 'A';
-        rInternal->octave = rFile[1] & 15;
-        rInternal->volume = rFile[2];
-        rInternal->effects = std::vector<effect>(4);
-        for (unsigned char effectIdx = 0; effectIdx < 4; effectIdx++) {
-          effect &eInternal = rInternal->effects.at(effectIdx);
-          unsigned char *eFile = rFile + 3 + (effectIdx * 3);
-          eInternal.type = static_cast<effectTypes>(eFile[0]);
-          eInternal.effect =
-              ((static_cast<unsigned short>(eFile[1] & 255) << 8) +
-               (static_cast<unsigned short>(eFile[2] & 255)));
-        }
-      }
-    }
-    delete[] buffer;
-    cmd::log::debug("Read order table for instrument {}", tableIdx);
-  }
-  file.close();
-  cmd::log::debug("File read successfully");
+  cmd::log::debug("Rendered successfully");
   return 0;
 }
 
 int renderTo(path path) {
-  cmd::log::notice("Rendering to file {}", path.string());
-  if (orders.tableCount() < 1) {
-    cmd::log::notice("Refusing to render without instruments");
+  return renderSong(currentSong, path, audio::renderThreads,
+                    audio::renderStems);
+}
+
+/**********************
+ * Background renders *
+ **********************/
+
+int startRender(path path) {
+  if (backgroundRender) {
+    cmd::log::notice("A render is already running");
     return 1;
   }
-  std::ofstream file(path, std::ios::out | std::ios::binary);
-  if (!file || !file.is_open()) {
-    cmd::log::error("Couldn't open the file");
+  if (currentSong.orders.tableCount() < 1) {
+    cmd::log::notice("Refusing to render without instruments");
     return 1;
   }
-  // Estimate the song length
-  size_t songLength = 48000 * 120;
-  songLength *= patternLength;
-  songLength *= indexes.rowCount();
-  songLength /= audio::tempo;
-  // Make a buffer whose length is the file size
-  size_t fileSize = (songLength * 2) + 44;
-  auto buffer = std::make_unique<unsigned char[]>(fileSize);
-  size_t headerIdx = 0;
-  // Write a WAV header
-  {
-    // RIFF
-    strcpy(reinterpret_cast<char *>(&buffer[0]),
-           "RIFF"); // up to 3 (null at 4 must be overwritten)
-    headerIdx += 4;
-    // File size - 8 (song size + 36)
-    write32LE(buffer.get(), fileSize - 8, headerIdx);
-    // WAVEfmt\0
-    strcpy(reinterpret_cast<char *>(&buffer[headerIdx]),
-           "WAVEfmt "); // up to 15 (null at 16 must be overwritten)
-    headerIdx += 8;
-    // the length of everything before this
-    write32LE(buffer.get(), headerIdx, headerIdx);
-    // PCM
-    write16LE(buffer.get(), 1, headerIdx);
-    // Mono
-    write16LE(buffer.get(), 1, headerIdx);
-    // 48kHz
-    {
-      constexpr unsigned int sampleRate = 48000;
-      write32LE(buffer.get(), sampleRate, headerIdx);
-      // Again (sr*16*1)/8 = sr * 2
-      // (samplerate * bit depth * channel count) / 8
-      write32LE(buffer.get(), sampleRate * 2, headerIdx);
-    }
-    // 16 bit mono
-    write16LE(buffer.get(), 2, headerIdx);
-    // 16 bits
-    write16LE(buffer.get(), 16, headerIdx);
-    // data
-    strcpy(reinterpret_cast<char *>(&buffer[36]),
-           "data"); // up to 39 (null at 40 must be overwritten)
-    headerIdx += 4;
-    // Data chunk length
-    write32LE(buffer.get(), fileSize - 44, headerIdx);
-  }
-  cmd::log::debug("WAV header written");
-  audio::pattern = 0;
-  audio::row = 0;
-  audio::freeze = true;
-  while (!audio::isFrozen) {
-  };
+  cmd::log::notice("Rendering to file {} in the background", path.string());
+  backgroundRender =
+      std::make_unique<renderJob>(currentSong, path, audio::renderThreads,
+                                  audio::renderStems);
+  backgroundRender->start();
+  return 0;
+}
 
-  if (timerSystem.hasTimer("row"))
-    timerSystem.removeTimer("row");
-  if (timerSystem.hasTimer("effect"))
-    timerSystem.removeTimer("effect");
-  if (timerSystem.hasTimer("arpeggio"))
-    timerSystem.removeTimer("arpeggio");
-  timerSystem.addTimer("row", 48000 * 60 / audio::tempo);
-  timerSystem.addTimer("effect", 375 * 960 / audio::tempo);
-  timerSystem.addTimer("arpeggio", 1500 * 960 / audio::tempo);
-  row dummyRow = {rowFeature::note_cut, 'A', 4, 0, std::vector<effect>(0)};
-  for (char i = 0; i < 4; i++)
-    dummyRow.effects.push_back(effect{effectTypes::arpeggio, 0});
-  for (unsigned char i = 0; i < instrumentSystem.inst_count(); i++) {
-    unsigned char patternIndex = indexes.at(audio::pattern)->at(i);
-    row *currentRow = orders.at(i)->at(patternIndex)->at(audio::row);
-    instrumentSystem.at(i)->set_row(dummyRow);
-    instrumentSystem.at(i)->set_row(*currentRow);
-  }
-  for (unsigned int audioIdx = 0; audioIdx < songLength; audioIdx++) {
-    short sample = 0;
-    for (unsigned char instrumentIdx = 0;
-         instrumentIdx < instrumentSystem.inst_count(); instrumentIdx++) {
-      sample = std::min(
-          32767,
-          std::max(-32767, static_cast<Sint32>(sample) +
-                               static_cast<Sint32>(
-                                   instrumentSystem.at(instrumentIdx)->gen()) /
-                                   4));
+bool renderInProgress() { return backgroundRender != nullptr; }
+
+void cancelRender() {
+  if (backgroundRender) backgroundRender->cancel();
+}
+
+// Called every frame; reports a background render once it finishes
+void pollRender() {
+  if (!backgroundRender || !backgroundRender->isFinished())
+    return;
+  bool inRenderMenu = gui::currentMenu == GlobalMenus::render_menu;
+  switch (backgroundRender->getStatus()) {
+  case renderStatus::done:
+    cmd::log::notice("Rendered to {}", backgroundRender->getPath().string());
+    if (inRenderMenu) {
+      gui::currentMenu = GlobalMenus::pattern_menu;
+      onOpenMenuMain();
+    }
+    break;
+  case renderStatus::cancelled:
+    cmd::log::notice("Render cancelled");
+    fileMenu_errorText = const_cast<char *>("Render cancelled");
+    if (inRenderMenu) {
+      gui::currentMenu = GlobalMenus::file_menu;
+      onOpenMenuMain();
+    }
+    break;
+  default:
+    cmd::log::error("Render failed: {}", backgroundRender->getError());
+    fileMenu_errorText = const_cast<char *>("Couldn't render to the file");
+    if (inRenderMenu) {
+      gui::currentMenu = GlobalMenus::file_menu;
+      onOpenMenuMain();
     }
-    buffer[audioIdx * 2 + 44] = sample << 8;
-    buffer[audioIdx * 2 + 45] = sample >> 8;
-    audioTickTimers();
+    break;
   }
-  if (timerSystem.hasTimer("row"))
-    timerSystem.removeTimer("row");
-  if (timerSystem.hasTimer("effect"))
-    timerSystem.removeTimer("effect");
-  if (timerSystem.hasTimer("arpeggio"))
-    timerSystem.removeTimer("arpeggio");
-  audio::freeze = false;
-  file.write(reinterpret_cast<char *>(buffer.get()), fileSize);
-  file.close();
-  cmd::log::debug("Rendered successfully");
-  return 0;
+  backgroundRender.reset();
 }
 
 /*******************
  * Audio callbacks *
  *******************/
 
-void audioCallback(void *userdata, Uint8 *stream, int len) {
+void fillAudio(void *userdata, Uint8 *stream, int len) {
   (void)userdata;
   if (audio::errorIsPresent)
     return;
@@ -724,51 +383,22 @@ void audioCallback(void *userdata, Uint8 *stream, int len) {
       return;
     }
 
-    if (!audio::freeze && audio::isPlaying && orders.tableCount() > 0) {
-      if (!timerSystem.hasTimer("row"))
-        timerSystem.addTimer("row", audio::spec.freq * 60 / audio::tempo);
-      if (!timerSystem.hasTimer("effect"))
-        timerSystem.addTimer("effect",
-                             audio::spec.freq / 128 * 960 / audio::tempo);
-      if (!timerSystem.hasTimer("arpeggio"))
-        timerSystem.addTimer("arpeggio",
-                             audio::spec.freq / 32 * 960 / audio::tempo);
-
-      for (unsigned int audioIdx = 0;
-           audioIdx < static_cast<unsigned int>(samples); audioIdx++) {
-        Sint16 sample = 0;
-        for (unsigned char instrumentIdx = 0;
-             instrumentIdx < instrumentSystem.inst_count(); instrumentIdx++) {
-          sample = std::min(
-              32767,
-              std::max(-32767,
-                       static_cast<Sint32>(sample) +
-                           static_cast<Sint32>(
-                               instrumentSystem.at(instrumentIdx)->gen()) /
-                               4));
-        }
-        data[audioIdx] = gui::waveformDisplay.at(gui::waveformIdx++) = sample;
-        if(gui::waveformIdx >= WAVEFORM_SAMPLE_COUNT) gui::waveformIdx = 0;
-        audioTickTimers();
-        audio::time++;
+    if (!audio::freeze && audio::isPlaying &&
+        currentSong.orders.tableCount() > 0) {
+      if (!livePlayer.isRunning())
+        livePlayer.start(audio::audioChannelFrequency);
+
+      livePlayer.mix(data, samples);
+      for (int i = 0; i < samples; i++) {
+        gui::waveformDisplay.at(gui::waveformIdx++) = data[i];
+        if (gui::waveformIdx >= WAVEFORM_SAMPLE_COUNT) gui::waveformIdx = 0;
       }
+      audio::time += samples;
     } else {
       if (!audio::freeze) {
-        if (timerSystem.hasTimer("row"))
-          timerSystem.removeTimer("row");
-        if (timerSystem.hasTimer("effect"))
-          timerSystem.removeTimer("effect");
-        if (timerSystem.hasTimer("arpeggio"))
-          timerSystem.removeTimer("arpeggio");
-        audio::row = 0;
-        audio::pattern = gui::patternMenuOrderIndex;
-        row dummyRow = {rowFeature::note_cut, 'A', 4, 0,
-                        std::vector<effect>(0)};
-        for (char i = 0; i < 4; i++)
-          dummyRow.effects.push_back(effect{effectTypes::arpeggio, 0});
-        for (unsigned char i = 0; i < instrumentSystem.inst_count(); i++) {
-          instrumentSystem.at(i)->set_row(dummyRow);
-        }
+        livePlayer.stop();
+        livePlayer.setPosition(gui::patternMenuOrderIndex, 0);
+        livePlayer.silence();
       }
       for (int i = 0; i < samples; i++) {
         data[i] /= 2;
@@ -783,6 +413,29 @@ void audioCallback(void *userdata, Uint8 *stream, int len) {
   }
 }
 
+// Times every callback against the time its buffer takes to play
+void audioCallback(void *userdata, Uint8 *stream, int len) {
+  auto start = std::chrono::steady_clock::now();
+  fillAudio(userdata, stream, len);
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  uint64_t deadline = static_cast<uint64_t>(len / 2) * 1000000000ULL /
+                      static_cast<uint64_t>(audio::spec.freq);
+  audio::callbackTiming.record(elapsed, deadline);
+}
+
+void logCallbackTiming() {
+  callbackTimings t = audio::callbackTiming.summary();
+  cmd::log::notice("Audio callback: {} calls, min {:.0f}us, avg {:.0f}us, "
+                   "max {:.0f}us, p99 {:.0f}us of {:.0f}us",
+                   t.count, t.min, t.average, t.max, t.p99, t.deadline);
+  cmd::log::notice("Audio callback: {} over {:.0f}% of the deadline",
+                   t.overruns, t.overrunFraction * 100);
+}
+
+void resetCallbackTiming() { audio::callbackTiming.reset(); }
+
 void whoops(void *userdata, Uint8 *stream, int len) {
   (void)userdata;
   for (int i = 0; i < len; i++) {
@@ -838,7 +491,8 @@ void init() {
                      preferred.freq, audio::spec.freq);
     audio::audioChannelFrequency = audio::spec.freq;
   }
-  indexes.addRow();
+  cmd::log::debug("Mixing with {} kernels", mixer::kernelName());
+  currentSong.indexes.addRow();
   SDL_PauseAudioDevice(audio::deviceID, 0);
 }
 
@@ -850,37 +504,39 @@ void setLimits(unsigned int &limitX, unsigned int &limitY) {
   switch (gui::currentMenu) {
   case GlobalMenus::instrument_menu: {
     limitX = 0;
-    limitY = instrumentSystem.inst_count() - 1;
+    limitY = currentSong.instruments.inst_count() - 1;
     break;
   }
   case GlobalMenus::order_menu: {
-    limitX = indexes.instCount(0) - 1;
-    limitY = indexes.rowCount() - 1;
+    limitX = currentSong.indexes.instCount(0) - 1;
+    limitY = currentSong.indexes.rowCount() - 1;
     break;
   }
   case GlobalMenus::order_management_menu: {
-    if (gui::cursorPosition.subMenu == 1 && orders.tableCount() > 0) {
-      limitX = orders.tableCount() - 1;
+    if (gui::cursorPosition.subMenu == 1 &&
+        currentSong.orders.tableCount() > 0) {
+      limitX = currentSong.orders.tableCount() - 1;
       limitY = 0;
       break;
     }
-    limitY = orders.tableCount() - 1;
-    if (orders.tableCount() > 0)
-      limitX = orders.at(gui::cursorPosition.y)->order_count() - 1;
+    limitY = currentSong.orders.tableCount() - 1;
+    if (currentSong.orders.tableCount() > 0)
+      limitX =
+          currentSong.orders.at(gui::cursorPosition.y)->order_count() - 1;
     else
       limitX = 0;
     break;
   }
   case GlobalMenus::pattern_menu: {
-    if (orders.tableCount() < 1) {
+    if (currentSong.orders.tableCount() < 1) {
       limitX = limitY = 0;
       break;
     }
     limitX = patternMenu_instrumentVariableCount[static_cast<size_t>(
                  gui::patternMenuViewMode)] *
-                 orders.tableCount() -
+                 currentSong.orders.tableCount() -
              1;
-    limitY = orders.at(0)->at(0)->rowCount() - 1;
+    limitY = currentSong.orders.at(0)->view(0)->rowCount() - 1;
     break;
   }
   case GlobalMenus::options_menu: {
@@ -911,7 +567,7 @@ void sdlEventHandler(SDL_Event *event, int &quit) {
   case SDL_TEXTINPUT: {
     if (gui::currentMenu == GlobalMenus::save_file_menu)
       saveFileMenu_fileName += event->text.text;
-    if (gui::currentMenu == GlobalMenus::render_menu)
+    if (gui::currentMenu == GlobalMenus::render_menu && !backgroundRender)
       renderMenu_fileName += event->text.text;
     break;
   }
@@ -921,9 +577,11 @@ void sdlEventHandler(SDL_Event *event, int &quit) {
                  fileMenu_directoryPath, fileMenu_errorText,
                  global_unsavedChanges, limitX, limitY, audio::freeze,
                  audio::isFrozen, gui::patternMenuOrderIndex,
-                 gui::patternMenuViewMode, audio::isPlaying, instrumentSystem,
-                 indexes, orders, audio::pattern, patternLength,
-                 currentKeyStates, audio::tempo);
+                 gui::patternMenuViewMode, audio::isPlaying,
+                 currentSong.instruments, currentSong.indexes,
+                 currentSong.orders, livePlayer.getPattern(),
+                 currentSong.patternLength, currentKeyStates,
+                 currentSong.tempo);
     break;
   }
   case SDL_KEYUP: {
@@ -933,7 +591,7 @@ void sdlEventHandler(SDL_Event *event, int &quit) {
       if (code == 's')
         gui::currentMenu = GlobalMenus::save_file_menu;
       else if (code == 'r') {
-        if (orders.tableCount() < 1)
+        if (currentSong.orders.tableCount() < 1)
           fileMenu_errorText =
               const_cast<char *>("Refusing to render without instruments");
         else
@@ -969,13 +627,23 @@ void sdlLoop(SDL_Renderer *renderer, SDL_Window *window) {
     while (SDL_PollEvent(&event)) {
       sdlEventHandler(&event, quit);
     }
+    pollRender();
     screenUpdate(renderer, window, gui::lastWindowWidth, gui::lastWindowHeight,
                  gui::currentMenu, audio::isPlaying, gui::waveformDisplay,
-                 global_unsavedChanges, gui::cursorPosition, indexes,
-                 audio::pattern, audio::row, orders, gui::patternMenuOrderIndex,
-                 gui::patternMenuViewMode, instrumentSystem, audio::tempo,
-                 patternLength, fileMenu_errorText, fileMenu_directoryPath,
+                 global_unsavedChanges, gui::cursorPosition,
+                 currentSong.indexes, livePlayer.getPattern(),
+                 livePlayer.getRow(), currentSong.orders,
+                 gui::patternMenuOrderIndex, gui::patternMenuViewMode,
+                 currentSong.instruments, currentSong.tempo,
+                 currentSong.patternLength,
+                 fileMenu_errorText, fileMenu_directoryPath,
                  saveFileMenu_fileName, renderMenu_fileName,
+                 backgroundRender ? backgroundRender->getProgress() : -1,
+                 // Only the debug menu shows these, and summing the
+                 // histogram every frame isn't free
+                 gui::currentMenu == GlobalMenus::debug_menu
+                     ? audio::callbackTiming.summary()
+                     : callbackTimings(),
                  documentationDirectory);
     SDL_RenderPresent(renderer);
     if (quit) {
@@ -1063,24 +731,93 @@ void errorScreen(SDL_Renderer *r, SDL_Window *w, const std::exception &e) {
 
 void printHelp() {
 #define pH(x) std::cout << x
-  pH("Usage: " << executableAbsolutePath << " [-l 0-4] [-v] [FILE]"
+  pH("Usage: " << executableAbsolutePath
+               << " [-l 0-4] [-v] [-j N] [-s] [-x PERCENT] [FILE]"
+               << "\n");
+  pH("       " << executableAbsolutePath
+               << " --render FILE [-o OUT] [-l 0-4] [-v] [-j N] [-s]"
+               << "\n");
+  pH("       " << executableAbsolutePath
+               << " --batch-render DIR [-o OUTDIR] [-l 0-4] [-v] [-j N] [-s]"
+               << "\n");
+  pH("       " << executableAbsolutePath
+               << " --check DIR [-u] [-t] [-l 0-4] [-v] [-j N]"
                << "\n\n");
   pH("-l --loglevel: Change loglevel. Lower is more verbose"
      << "\n");
   pH("-v --verbose : increase verbosity"
+     << "\n");
+  pH("-j --jobs    : threads to render with (default: one per core)"
+     << "\n");
+  pH("-s --stems   : also write a WAV per instrument (OUT-000.wav, ...)"
+     << "\n");
+  pH("-x --xrun PERCENT: count audio callbacks slower than this much of"
+     << "\n");
+  pH("                   their deadline as xruns (default: 80)"
+     << "\n\n");
+  pH("-r --render  : render FILE to a WAV file and exit, without a window"
+     << "\n");
+  pH("-o --output  : where --render writes (default: FILE with .wav)"
+     << "\n");
+  pH("-b --batch-render: render every .cht file in DIR, -j at a time"
+     << "\n");
+  pH("                   (WAVs go to OUTDIR, or next to the songs)"
+     << "\n");
+  pH("-c --check   : render every .cht file in DIR and compare against"
+     << "\n");
+  pH("               DIR/golden.txt, failing on a different PCM hash or a"
+     << "\n");
+  pH("               render slower than its budget"
+     << "\n");
+  pH("-u --update-golden: with --check, rewrite DIR/golden.txt instead"
+     << "\n");
+  pH("-t --time-report-only: with --check, report renders over their budget"
+     << "\n");
+  pH("                   without failing on them (for shared machines)"
      << "\n\n");
   pH("if FILE is included, load it automatically." << std::endl);
 #undef pH
 }
 
-void processCommandLineArgumentBeforeInit(const char **argv,
+// The argument after an option that takes one, moving p onto it. Prints the
+// usage and quits if the command line ends first.
+const char *optionValue(const char **argv, int argc, int &p,
+                        const std::string &option) {
+  if (p + 1 >= argc) {
+    printHelp();
+    cmd::log::critical("Option " + option + " needs a value");
+    quit(1);
+  }
+  return argv[++p];
+}
+
+void processCommandLineArgumentBeforeInit(const char **argv, int argc,
                                           std::string &argument, int &p) {
-  if (argument.at(0) == '-') {
+  if (!argument.empty() && argument.at(0) == '-') {
     if (argument == "--loglevel" || argument == "-l") {
-      cmd::log::level = atoi(argv[++p]);
+      cmd::log::level = atoi(optionValue(argv, argc, p, argument));
     } else if (argument == "--verbose" || argument == "-v") {
       if (cmd::log::level > 0)
         cmd::log::level--;
+    } else if (argument == "--jobs" || argument == "-j") {
+      audio::renderThreads = atoi(optionValue(argv, argc, p, argument));
+    } else if (argument == "--xrun" || argument == "-x") {
+      audio::callbackTiming.setOverrunPercent(
+          std::max(1, atoi(optionValue(argv, argc, p, argument))));
+    } else if (argument == "--stems" || argument == "-s") {
+      audio::renderStems = true;
+    } else if (argument == "--render" || argument == "-r") {
+      headlessRenderInput = optionValue(argv, argc, p, argument);
+    } else if (argument == "--output" || argument == "-o") {
+      headlessRenderOutput = optionValue(argv, argc, p, argument);
+    } else if (argument == "--batch-render" || argument == "-b") {
+      batchRenderDirectory = optionValue(argv, argc, p, argument);
+    } else if (argument == "--check" || argument == "-c") {
+      goldenCheckDirectory = optionValue(argv, argc, p, argument);
+    } else if (argument == "--update-golden" || argument == "-u") {
+      goldenUpdate = true;
+    } else if (argument == "--time-report-only" || argument == "-t") {
+      goldenTimeReportOnly = true;
     } else if (argument == "--help" || argument == "-?" || argument == "-h") {
       printHelp();
       exit(0);
@@ -1090,10 +827,13 @@ void processCommandLineArgumentBeforeInit(const char **argv,
 
 void processCommandLineArgumentAfterInit(const char **argv,
                                          std::string &argument, int &p) {
-  if (argument.at(0) == '-') {
-    if (argument == "--loglevel" || argument == "-l") {
+  if (!argument.empty() && argument.at(0) == '-') {
+    if (argument == "--loglevel" || argument == "-l" ||
+        argument == "--jobs" || argument == "-j" || argument == "--output" ||
+        argument == "-o" || argument == "--xrun" || argument == "-x") {
       p++;
-    } else if (argument == "--verbose" || argument == "-v") {
+    } else if (argument == "--verbose" || argument == "-v" ||
+               argument == "--stems" || argument == "-s") {
     } else {
       printHelp();
       cmd::log::critical("Unknown option " + argument);
@@ -1113,6 +853,280 @@ void processCommandLineArgumentAfterInit(const char **argv,
   }
 }
 
+// Renders the --render song without starting SDL, for servers with no
+// display or sound card
+int renderHeadless() {
+  if (headlessRenderOutput.empty()) {
+    headlessRenderOutput = headlessRenderInput;
+    headlessRenderOutput.replace_extension(".wav");
+  }
+  if (loadFile(headlessRenderInput))
+    return 1;
+  return renderTo(headlessRenderOutput);
+}
+
+struct batchResult {
+  bool rendered = false;
+  double seconds = 0;
+  size_t samples = 0;
+};
+
+// Renders every .cht file in the --batch-render directory to a WAV file, a
+// song per thread, and prints how long each one took. Songs are loaded into
+// their own song structs, so nothing is shared between threads.
+int batchRender() {
+  std::vector<path> songs;
+  std::error_code error;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(batchRenderDirectory, error)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".cht")
+      songs.push_back(entry.path());
+  }
+  if (error) {
+    cmd::log::critical("Couldn't read {}: {}", batchRenderDirectory.string(),
+                       error.message());
+    return 1;
+  }
+  if (songs.empty()) {
+    cmd::log::warning("No .cht files in {}", batchRenderDirectory.string());
+    return 0;
+  }
+  std::sort(songs.begin(), songs.end());
+  path outputDirectory = headlessRenderOutput.empty() ? batchRenderDirectory
+                                                      : headlessRenderOutput;
+  unsigned int jobs = audio::renderThreads;
+  if (jobs == 0)
+    jobs = std::thread::hardware_concurrency();
+  jobs = std::clamp<size_t>(jobs, 1, songs.size());
+  cmd::log::notice("Rendering {} songs on {} threads", songs.size(), jobs);
+
+  std::vector<batchResult> results(songs.size());
+  std::atomic<size_t> nextSong{0};
+  auto work = [&]() {
+    for (size_t i = nextSong++; i < songs.size(); i = nextSong++) {
+      auto start = std::chrono::steady_clock::now();
+      song music;
+      char *errorText = const_cast<char *>("");
+      path output = outputDirectory / songs[i].filename();
+      output.replace_extension(".wav");
+      if (loadSong(music, songs[i], errorText) != 0) {
+        cmd::log::error("Couldn't load {}", songs[i].string());
+      } else if (music.orders.tableCount() < 1) {
+        cmd::log::error("{} has no instruments", songs[i].string());
+      } else {
+        // The songs are already spread over the threads
+        renderJob job(music, output, 1, audio::renderStems);
+        results[i].rendered = job.render() == renderStatus::done;
+        results[i].samples = job.getTiming().length;
+        if (!results[i].rendered)
+          cmd::log::error("Couldn't render {}: {}", songs[i].string(),
+                          job.getError());
+      }
+      results[i].seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+    }
+  };
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (unsigned int t = 1; t < jobs; t++)
+    workers.emplace_back(work);
+  work();
+  for (std::thread &worker : workers)
+    worker.join();
+  double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  size_t failed = 0;
+  size_t samples = 0;
+  for (size_t i = 0; i < songs.size(); i++) {
+    const batchResult &r = results[i];
+    if (!r.rendered)
+      failed++;
+    samples += r.samples;
+    std::cout << fmt::format("{:6} {:8.3f}s {:14.0f} samples/s  {}\n",
+                             r.rendered ? "ok" : "FAILED", r.seconds,
+                             r.seconds > 0 ? r.samples / r.seconds : 0,
+                             songs[i].filename().string());
+  }
+  std::cout << fmt::format(
+      "Rendered {} of {} songs, {} samples in {:.3f}s ({:.0f} samples/s)\n",
+      songs.size() - failed, songs.size(), samples, seconds,
+      seconds > 0 ? samples / seconds : 0);
+  return failed > 0 ? 1 : 0;
+}
+
+/*****************
+ * Golden checks *
+ *****************/
+
+// A render may take this many times its budget before it's SLOW, plus a
+// quarter second so that very short songs don't fail on timer noise or a
+// busy machine. The hash is the real gate; the budget only catches renders
+// that got a lot slower.
+constexpr double goldenBudgetSlack = 3.0;
+constexpr double goldenBudgetMinimum = 0.25;
+
+struct goldenEntry {
+  uint64_t hash = 0;
+  double budget = 0;
+};
+
+// FNV-1a over the samples of a WAV written by wavWriter (after its 44 byte
+// header), so the header's sizes don't count twice
+uint64_t hashPCM(const path &wav) {
+  std::ifstream file(wav, std::ios::binary);
+  file.seekg(44);
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  std::array<char, 65536> buffer;
+  while (file) {
+    file.read(buffer.data(), buffer.size());
+    for (std::streamsize i = 0; i < file.gcount(); i++) {
+      hash ^= static_cast<unsigned char>(buffer[i]);
+      hash *= 0x100000001b3ULL;
+    }
+  }
+  return hash;
+}
+
+// Removes the WAV each song of a check is rendered to, whichever way the check
+// ends. Its name has the process ID in it, so checks can run side by side.
+struct goldenScratchFile {
+  path file;
+  goldenScratchFile() {
+#ifdef _WIN32
+    unsigned long id = GetCurrentProcessId();
+#else
+    unsigned long id = getpid();
+#endif
+    file = std::filesystem::temp_directory_path() /
+           fmt::format("chtracker-check-{}.wav", id);
+  }
+  ~goldenScratchFile() {
+    std::error_code ignored;
+    std::filesystem::remove(file, ignored);
+  }
+};
+
+// Renders every .cht file in the --check directory through the same path as
+// --render and compares the PCM against DIR/golden.txt, a line per song of
+// "file.cht hash budget-in-seconds". With --update-golden the file is
+// rewritten from these renders instead; check the new hashes in with the
+// change that altered the sound, and only then. With --time-report-only a
+// render over its budget is still reported as SLOW but doesn't fail.
+int checkGolden() {
+  path manifestPath = goldenCheckDirectory / "golden.txt";
+  std::map<string, goldenEntry> golden;
+  {
+    std::ifstream manifest(manifestPath);
+    string line;
+    while (std::getline(manifest, line)) {
+      std::istringstream fields(line);
+      string name;
+      goldenEntry entry;
+      if (line.empty() || line[0] == '#')
+        continue;
+      if (!(fields >> name >> std::hex >> entry.hash >> std::dec >>
+            entry.budget)) {
+        cmd::log::critical("Bad line in {}: {}", manifestPath.string(), line);
+        return 1;
+      }
+      golden[name] = entry;
+    }
+  }
+
+  std::vector<path> songs;
+  std::error_code error;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(goldenCheckDirectory, error)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".cht")
+      songs.push_back(entry.path());
+  }
+  if (error) {
+    cmd::log::critical("Couldn't read {}: {}", goldenCheckDirectory.string(),
+                       error.message());
+    return 1;
+  }
+  std::sort(songs.begin(), songs.end());
+
+  size_t failed = 0;
+  std::map<string, goldenEntry> measured;
+  goldenScratchFile scratch;
+  const path &output = scratch.file;
+  for (const path &songPath : songs) {
+    string name = songPath.filename().string();
+    song music;
+    char *errorText = const_cast<char *>("");
+    if (loadSong(music, songPath, errorText) != 0) {
+      std::cout << fmt::format("{:8} {}: couldn't load\n", "FAILED", name);
+      failed++;
+      continue;
+    }
+    auto start = std::chrono::steady_clock::now();
+    renderJob job(music, output, audio::renderThreads);
+    bool rendered = job.render() == renderStatus::done;
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count();
+    if (!rendered) {
+      std::cout << fmt::format("{:8} {}: {}\n", "FAILED", name,
+                               job.getError());
+      failed++;
+      continue;
+    }
+    goldenEntry result = {hashPCM(output), seconds};
+    std::filesystem::remove(output);
+    measured[name] = result;
+    if (goldenUpdate) {
+      std::cout << fmt::format("{:8} {} {:016x} {:.3f}s\n", "updated", name,
+                               result.hash, seconds);
+      continue;
+    }
+
+    auto expected = golden.find(name);
+    string verdict = "ok";
+    if (expected == golden.end())
+      verdict = "NEW";
+    else if (expected->second.hash != result.hash)
+      verdict = "CHANGED";
+    else if (seconds > expected->second.budget * goldenBudgetSlack +
+                           goldenBudgetMinimum)
+      verdict = "SLOW";
+    if (verdict != "ok" && !(verdict == "SLOW" && goldenTimeReportOnly))
+      failed++;
+    std::cout << fmt::format(
+        "{:8} {} {:016x} {:.3f}s (budget {:.3f}s)\n", verdict, name,
+        result.hash, seconds,
+        expected == golden.end() ? 0.0 : expected->second.budget);
+  }
+  if (!goldenUpdate) {
+    for (const auto &[name, entry] : golden) {
+      if (measured.count(name) == 0 &&
+          !std::filesystem::exists(goldenCheckDirectory / name)) {
+        std::cout << fmt::format("{:8} {}\n", "MISSING", name);
+        failed++;
+      }
+    }
+  }
+
+  if (goldenUpdate) {
+    std::ofstream manifest(manifestPath);
+    manifest << "# file, hash of the rendered PCM, render budget in seconds\n";
+    for (const auto &[name, entry] : measured)
+      manifest << fmt::format("{} {:016x} {:.3f}\n", name, entry.hash,
+                              entry.budget);
+    if (!manifest) {
+      cmd::log::critical("Couldn't write {}", manifestPath.string());
+      return 1;
+    }
+  }
+  std::cout << fmt::format("{} of {} songs {}\n", songs.size() - failed,
+                           songs.size(),
+                           goldenUpdate ? "updated" : "passed");
+  return failed > 0 ? 1 : 0;
+}
+
 /*****************
  * Main function *
  *****************/
@@ -1140,10 +1154,16 @@ int main(int argc, char *argv[]) {
   if (argc > 1) {
     for (int p = 1; p < argc; p++) {
       string arg(argv[p]);
-      processCommandLineArgumentBeforeInit(const_cast<const char **>(argv), arg,
-                                           p);
+      processCommandLineArgumentBeforeInit(const_cast<const char **>(argv),
+                                           argc, arg, p);
     }
   }
+  if (!goldenCheckDirectory.empty())
+    quit(checkGolden());
+  if (!batchRenderDirectory.empty())
+    quit(batchRender());
+  if (!headlessRenderInput.empty())
+    quit(renderHeadless());
 #if defined(_POSIX)
   if (std::strcmp(std::getenv("USER"), "root") == 0) {
     cmd::log::warning("Please don't run this program as root");
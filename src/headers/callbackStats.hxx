@@ -0,0 +1,76 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/headers/callbackStats.hxx
+  This is a declaration file; For implementation see path
+  ./src/callbackStats.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+#ifndef _CHTRACKER_CALLBACKSTATS_HXX
+#define _CHTRACKER_CALLBACKSTATS_HXX
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+struct callbackTimings {
+    uint64_t count = 0;
+    // Callbacks that took longer than the overrun fraction of their deadline
+    uint64_t overruns = 0;
+    // All in microseconds
+    double min = 0;
+    double average = 0;
+    double max = 0;
+    double p99 = 0;
+    double deadline = 0;
+    double overrunFraction = 0;
+};
+
+/**
+ * How long the audio callback takes, next to how long it has: the time the
+ * buffer it fills takes to play. The audio thread records; any other thread
+ * can read a summary or ask for a reset. Nothing here takes a lock, so the
+ * audio thread can't be held up by the GUI reading it.
+ *
+ * p99 comes from a histogram of 25 microsecond buckets, so it's only that
+ * precise; anything over the last bucket counts as the last bucket.
+ */
+class callbackStats {
+    private:
+    static constexpr uint64_t bucketWidth = 25000;
+    static constexpr size_t bucketCount = 2048;
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> overruns{0};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> minimum{UINT64_MAX};
+    std::atomic<uint64_t> maximum{0};
+    std::atomic<uint64_t> lastDeadline{0};
+    std::array<std::atomic<uint32_t>, bucketCount> histogram{};
+    std::atomic<unsigned int> overrunPercent{80};
+    std::atomic<bool> resetRequested{false};
+    public:
+    // Audio thread only; both in nanoseconds
+    void record(uint64_t elapsed, uint64_t deadline);
+    // Cleared by the audio thread on its next record()
+    void reset();
+    void setOverrunPercent(unsigned int percent);
+    unsigned int getOverrunPercent() const;
+    callbackTimings summary() const;
+};
+
+#endif
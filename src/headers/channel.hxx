@@ -24,6 +24,10 @@
 #define _CHTRACKER_CHANNEL_HXX
 
 #include "order.hxx"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 namespace audio {
@@ -51,32 +55,70 @@ struct audioChannelEffectFlags {
 
 class audioChannel {
     private:
-        unsigned short noiseLFSR = 1;
+        // Position in the precomputed LFSR output sequence; 0 is the state
+        // the register is seeded with (1).
+        uint32_t noisePosition = 0;
         row status;
         audioChannelType channelType = audioChannelType::null;
         struct audioChannelEffectFlags effects;
-        float phase = 0;
+        // Pulse, triangle and sawtooth run on a 32-bit fixed-point phase
+        // (0x100000000 is one cycle) so wraparound is free and doesn't drift.
+        // The LFSRs use it too, ticking once per overflow.
+        // At the same phase the waves match the old float versions within 1
+        // step of the 16-bit output; an edge may land one sample earlier or
+        // later where the float phase used to round differently.
+        uint32_t phaseAccumulator = 0;
+        // Per-tick state, refreshed whenever a row, effect or arpeggio step
+        // changes the channel instead of on every sample.
+        uint32_t phaseStep = 0;
+        uint32_t noiseTicksPerSample = 0;
+        short finalVolume = 0;
+        bool silent = true;
+        // Starts at audio::audioChannelFrequency; renders can use another
+        double sampleRate;
+        void refresh();
     public:
     audioChannel(audioChannelType type);
     void cycle_type();
     audioChannelType get_type();
-    void set_row(row r);
-    void noiseLFSRTick(char width);
+    void set_row(const row &r);
     void applyFx();
     void applyArpeggio();
     short gen();
+    void render(short *out, size_t frames);
+    void setSampleRate(double rate);
+    // False when render() would only write zeros: no note, or a null channel
+    bool isActive() const;
 };
 
+/**
+ * Holds the instruments, and a bitmap of the ones that are active so the
+ * mixer can skip the rest. A channel can't see the storage it's in, so
+ * whoever changes one (set_row, applyFx, applyArpeggio, cycle_type) calls
+ * refreshVoice for it afterwards. Different voices can be refreshed from
+ * different threads at once.
+ */
 class instrumentStorage {
     private:
     std::vector<audioChannel> instruments;
-    std::vector<audioChannel> erase_instruments;
+    // One bit per possible index; only the words up to activeWordCount() are
+    // ever looked at
+    std::array<std::atomic<uint64_t>, 1024> activeVoices{};
+    void refreshAllVoices();
     public:
     instrumentStorage();
-    unsigned char add_inst(audioChannelType type);
-    unsigned char inst_count();
-    void remove_inst(unsigned char idx);
-    audioChannel* at(unsigned char idx);
+    unsigned short add_inst(audioChannelType type);
+    unsigned short inst_count() const;
+    void remove_inst(unsigned short idx);
+    audioChannel* at(unsigned short idx);
+    void setSampleRate(double rate);
+    void refreshVoice(unsigned short idx);
+    bool isActive(unsigned short idx) const;
+    // Bits 64*word to 64*word+63 of the bitmap
+    uint64_t activeWord(unsigned short word) const;
+    // How many words of the bitmap cover the current instruments
+    unsigned short activeWordCount() const;
+    unsigned short activeCount() const;
 };
 
 #endif
\ No newline at end of file
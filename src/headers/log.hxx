@@ -25,6 +25,7 @@
 
 #include <fmt/core.h>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -57,9 +58,12 @@ namespace log {
  */
 extern int level;
 extern std::vector<struct log> logs;
+// Held while a message is added, so threads can log at the same time
+extern std::mutex mutex;
 template <typename... Args>
 void log(int severity, std::string &format, Args &&...args) {
   std::string msg = fmt::format(format, std::forward<Args>(args)...);
+  std::lock_guard<std::mutex> guard(mutex);
   if (level <= severity) {
     logs.push_back(
         {.msg = msg, .severity = static_cast<char>(severity), .printed = true});
@@ -100,7 +100,7 @@ struct CursorPos {
 *****************************************/
 
 MAIN_H_CONST unsigned char global_majorVersion /**/ = 0x00;
-MAIN_H_CONST unsigned char global_minorVersion /**/ = 0x04;
+MAIN_H_CONST unsigned char global_minorVersion /**/ = 0x06;
 MAIN_H_CONST unsigned char global_patchVersion /**/ = 0x00;
 MAIN_H_CONST unsigned char global_prereleaseVersion = 0x01;
 
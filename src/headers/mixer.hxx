@@ -0,0 +1,46 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/headers/mixer.hxx
+  This is a declaration file; For implementation see path
+  ./src/mixer.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+#ifndef _CHTRACKER_MIXER_HXX
+#define _CHTRACKER_MIXER_HXX
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mixer {
+/**
+ * Adds a block of channel output onto a 32-bit mixing bus. The bus can't
+ * clip, so the order channels are added in doesn't matter.
+ */
+void accumulate(int32_t *bus, const short *in, size_t frames);
+/**
+ * Scales the bus down to the master volume (a quarter, like the old per
+ * channel mix) and saturates it to 16 bits, -32767 to 32767.
+ */
+void saturate(short *out, const int32_t *bus, size_t frames);
+/**
+ * Name of the kernel set picked for this CPU: "AVX2", "SSE2" or "scalar"
+ */
+const char *kernelName();
+} // namespace mixer
+
+#endif
@@ -22,6 +22,10 @@
 
 #ifndef _CHTRACKER_ORDER_HXX
 #define _CHTRACKER_ORDER_HXX
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 enum class effectTypes {
@@ -36,7 +40,8 @@ enum class effectTypes {
 
 struct effect {
     effectTypes type = effectTypes::null;
-    unsigned short effect;
+    unsigned short effect = 0;
+    bool operator==(const struct effect &other) const;
 };
 
 struct effectValues {
@@ -55,77 +60,153 @@ enum class rowFeature {
     note_cut
 };
 
+// Plain data with the effects inline, so a pattern's rows are one allocation
 struct row {
     rowFeature feature = rowFeature::empty;
     char note = 'A';
     char octave = 4;
     unsigned char volume = 240;
-    std::vector<effect> effects = std::vector<effect>(4);
+    std::array<effect, 4> effects = {};
+    bool operator==(const row &other) const;
+    bool operator!=(const row &other) const;
 };
 
+/**
+ * A pattern. Only the rows that aren't blank (a default row) are stored:
+ * each one is an event, kept in row order, with the events' row numbers in
+ * one array, their features in the next and so on. Whole rows are copied in
+ * and out with get() and set(); code that wants every stored row (playing,
+ * saving, transposing) walks the events instead, and code that only needs
+ * one field can read the columns directly.
+ *
+ * Patterns are compared by a hash of their rows, worked out the first time
+ * it's asked for after a change. Working it out isn't thread safe, so only
+ * the thread that edits the song should ask.
+ */
 class order {
     private:
-    std::vector<row> rows;
+    unsigned short rows = 0;
+    std::vector<unsigned short> eventRows;
+    std::vector<rowFeature> features;
+    std::vector<char> notes;
+    std::vector<char> octaves;
+    std::vector<unsigned char> volumes;
+    std::array<std::vector<effectTypes>, 4> effectTypeColumns;
+    std::array<std::vector<unsigned short>, 4> effectValueColumns;
+    // Worked out by the first contentHash() after a change; 0 until then.
+    // Atomic because a shared pattern can be hashed from more than one thread
+    struct hashCache {
+        std::atomic<uint64_t> value{0};
+        hashCache() = default;
+        hashCache(const hashCache &other);
+        hashCache &operator=(const hashCache &other);
+    };
+    mutable hashCache hash;
+    void insertEvent(size_t event, unsigned short idx);
+    void eraseEvent(size_t event);
     public:
     order(unsigned short size);
 
+    // Shrinking drops the events past the end
     void setRowCount(unsigned short size);
     unsigned short rowCount() const;
-    row* at(unsigned short idx);
+    // Rows without an event are blank
+    row get(unsigned short idx) const;
+    // Setting a blank row removes its event
+    void set(unsigned short idx, const row &r);
+    size_t eventCount() const;
+    // The first event at or after row `idx`, or eventCount() if there isn't
+    // one
+    size_t firstEventFrom(unsigned short idx) const;
+    unsigned short eventRow(size_t event) const;
+    row eventAt(size_t event) const;
+    // Each column is eventCount() long, in event order
+    const unsigned short *eventRowColumn() const;
+    const rowFeature *featureColumn() const;
+    const char *noteColumn() const;
+    const char *octaveColumn() const;
+    const unsigned char *volumeColumn() const;
+    const effectTypes *effectTypeColumn(unsigned char effectIdx) const;
+    const unsigned short *effectValueColumn(unsigned char effectIdx) const;
+    // Moves every note by `semitones`, stopping at the lowest and highest
+    // notes there are
+    void transpose(int semitones);
+    // Equal patterns always have equal hashes
+    uint64_t contentHash() const;
+    bool operator==(const order &other) const;
 };
 
+/**
+ * An instrument's patterns. Patterns with the same rows can be shared, with
+ * each other and with other tables (and so with copies of the song being
+ * rendered); a shared pattern is copied the first time it's edited. at() is
+ * for editing and makes that copy, view() is for reading and never does.
+ */
 class instrumentOrderTable {
+    friend class orderStorage;
     private:
-    std::vector<order> orders;
-    std::vector<order> erase_orders;
+    std::vector<std::shared_ptr<order>> orders;
     unsigned short rowCount = 32;
     public:
     instrumentOrderTable(unsigned short size);
-    unsigned char add_order();
-    unsigned char order_count() const;
-    void remove_order(unsigned char idx);
+    unsigned short add_order();
+    // Adds `source`'s pattern `idx` to the end of this table, sharing it
+    unsigned short add_shared_order(const instrumentOrderTable &source, unsigned short idx);
+    unsigned short order_count() const;
+    void remove_order(unsigned short idx);
     void set_row_count(unsigned short size);
-    order* at(unsigned char idx);
+    order* at(unsigned short idx);
+    const order* view(unsigned short idx) const;
+    bool is_shared(unsigned short idx) const;
 };
 
+class orderIndexStorage;
+
 class orderStorage {
     private:
     std::vector<instrumentOrderTable> orderTables;
-    std::vector<instrumentOrderTable> erase_orderTables;
     unsigned short row_count = 32;
     public:
     orderStorage(unsigned short size);
-    unsigned char addTable();
-    unsigned char tableCount() const;
-    void removeTable(unsigned char idx);
+    unsigned short addTable();
+    unsigned short tableCount() const;
+    void removeTable(unsigned short idx);
     void setRowCount(unsigned short size);
     unsigned short rowCount() const;
-    instrumentOrderTable* at(unsigned char idx);
+    instrumentOrderTable* at(unsigned short idx);
+    // Makes every pattern share with the first pattern, in any table, with
+    // the same rows. Indexes don't change. Returns how many patterns joined
+    // another.
+    size_t intern();
+    // Interns, then removes every pattern that's the same as an earlier one
+    // in its table and points `indexes` at the earlier one instead. Returns
+    // how many patterns were removed. The new tables are worked out before
+    // anything changes, but nothing may read the song while they're swapped
+    // in: pause the audio device around this.
+    size_t deduplicate(orderIndexStorage &indexes);
 };
 
 class orderIndexRow {
     private:
-        std::vector<unsigned char> indexes;
-        std::vector<unsigned char> erase_indexes;
+        std::vector<unsigned short> indexes;
     public:
-        unsigned char addInst();
-        unsigned char instCount() const;
-        void removeInst(unsigned char idx);
-        unsigned char at(unsigned char idx);
-        void set(unsigned char idx, unsigned char value);
-        void increment(unsigned char idx);
-        void decrement(unsigned char idx);
-        unsigned char size() const;
+        unsigned short addInst();
+        unsigned short instCount() const;
+        void removeInst(unsigned short idx);
+        unsigned short at(unsigned short idx);
+        void set(unsigned short idx, unsigned short value);
+        void increment(unsigned short idx);
+        void decrement(unsigned short idx);
+        unsigned short size() const;
 };
 
 class orderIndexStorage {
     private:
     std::vector<orderIndexRow> rows;
-    std::vector<orderIndexRow> erase_rows;
     public:
-    unsigned char addInst();
-    unsigned char instCount(unsigned char fallback) const;
-    void removeInst(unsigned char idx);
+    unsigned short addInst();
+    unsigned short instCount(unsigned short fallback) const;
+    void removeInst(unsigned short idx);
     unsigned short addRow();
     unsigned short rowCount() const;
     void removeRow(unsigned short idx);
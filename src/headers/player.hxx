@@ -0,0 +1,73 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/headers/player.hxx
+  This is a declaration file; For implementation see path
+  ./src/player.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+#ifndef _CHTRACKER_PLAYER_HXX
+#define _CHTRACKER_PLAYER_HXX
+
+#include <cstddef>
+#include <vector>
+#include "sequencer.hxx"
+#include "song.hxx"
+
+struct songTiming {
+    // Samples from the first row until the song loops
+    size_t length = 0;
+    // Sample each order row starts on
+    std::vector<size_t> orderStarts;
+};
+
+/**
+ * Plays a song: keeps the play position, runs the sequencer and mixes the
+ * instruments. The live song and a render's copy of it each get their own
+ * player. Tempo changes in the song are picked up as it plays.
+ */
+class player {
+    private:
+    song &source;
+    sequencer clock;
+    unsigned short currentPattern = 0;
+    unsigned short currentRow = 0;
+    // Per instrument, the next event of the pattern it's playing, so moving
+    // on a row doesn't have to search the pattern. Only resized between
+    // dispatches.
+    std::vector<size_t> eventCursors;
+    void advanceRow();
+    void nextRow(unsigned short &patternIdx, unsigned short &rowIdx);
+    void dispatch(unsigned short instrument, const sequencerEvents &events,
+                  unsigned short patternIdx, unsigned short rowIdx);
+    public:
+    player(song &source);
+    void start(unsigned int sampleRate);
+    void stop();
+    bool isRunning() const;
+    void setPosition(unsigned short patternIdx, unsigned short rowIdx);
+    unsigned short getPattern() const;
+    unsigned short getRow() const;
+    void silence();
+    void cue();
+    void mix(short *out, size_t frames);
+    void render(short *out, size_t frames, unsigned int threads,
+                std::vector<std::vector<short>> *stems = nullptr);
+    songTiming measure(unsigned int sampleRate);
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/headers/render.hxx
+  This is a declaration file; For implementation see path
+  ./src/render.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+#ifndef _CHTRACKER_RENDER_HXX
+#define _CHTRACKER_RENDER_HXX
+
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include "player.hxx"
+#include "song.hxx"
+
+enum class renderStatus {
+    idle,
+    running,
+    done,
+    failed,
+    cancelled
+};
+
+/**
+ * Renders a WAV file from a copy of the song taken when the job is made, so
+ * the song can be edited and played while a background render runs. Renders
+ * are always 48kHz.
+ *
+ * With stems on, each instrument is also written to a WAV of its own next to
+ * the mix (see stemPath), at the same master volume, from the same pass.
+ */
+class renderJob {
+    private:
+    song snapshot;
+    player engine;
+    std::filesystem::path path;
+    unsigned int threads;
+    bool stems;
+    songTiming timing;
+    std::atomic<size_t> rendered{0};
+    std::atomic<bool> cancelRequested{false};
+    std::atomic<renderStatus> status{renderStatus::idle};
+    std::string error;
+    std::thread worker;
+    void run();
+    public:
+    static constexpr unsigned int sampleRate = 48000;
+    static constexpr size_t chunkLength = 65536;
+    static constexpr size_t minimumChunkLength = 1024;
+    // Samples of stem buffers a job holds at most, unless it has more than
+    // stemBufferSamples / minimumChunkLength instruments
+    static constexpr size_t stemBufferSamples = size_t(1) << 22;
+    renderJob(song &source, const std::filesystem::path &path, unsigned int threads = 0, bool stems = false);
+    ~renderJob();
+    renderStatus render();
+    void start();
+    void cancel();
+    renderStatus getStatus() const;
+    bool isFinished() const;
+    double getProgress() const;
+    const std::string &getError() const;
+    const std::filesystem::path &getPath() const;
+    const songTiming &getTiming() const;
+    /**
+     * Where the stem for `instrument` goes: "song.wav" gives "song-000.wav",
+     * "song-001.wav" and so on.
+     */
+    static std::filesystem::path stemPath(const std::filesystem::path &path, unsigned short instrument);
+};
+
+#endif
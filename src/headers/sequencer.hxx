@@ -0,0 +1,67 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/headers/sequencer.hxx
+  This is a declaration file; For implementation see path
+  ./src/sequencer.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+#ifndef _CHTRACKER_SEQUENCER_HXX
+#define _CHTRACKER_SEQUENCER_HXX
+
+#include <cstdint>
+#include "timer.hxx"
+
+struct sequencerEvents {
+    bool row = false;
+    bool effect = false;
+    bool arpeggio = false;
+};
+
+/**
+ * Keeps a timer for the next row, effect and arpeggio tick. Synthesis runs
+ * uninterrupted for samplesUntilEvent() samples, then advance() says which
+ * events are due.
+ *
+ * Event periods are 32.32 fixed-point sample counts. Each event fires on the
+ * last whole sample at or before its exact time and carries the fraction
+ * over, so rows stay where they belong at any tempo and sample rate.
+ */
+class sequencer {
+    private:
+    bool running = false;
+    unsigned int sampleRate = 48000;
+    unsigned short tempo = 960;
+    timerHandler timers;
+    timerID rowTimer = 0;
+    timerID effectTimer = 0;
+    timerID arpeggioTimer = 0;
+    uint32_t rowCarry = 0;
+    uint32_t effectCarry = 0;
+    uint32_t arpeggioCarry = 0;
+    uint64_t period(unsigned int perRow) const;
+    unsigned int nextLength(uint64_t period, uint32_t &carry) const;
+    public:
+    void start(unsigned short tempo, unsigned int sampleRate);
+    void stop();
+    bool isRunning() const;
+    void setTempo(unsigned short tempo);
+    unsigned int samplesUntilEvent();
+    sequencerEvents advance(unsigned int samples);
+};
+
+#endif
@@ -0,0 +1,39 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/headers/song.hxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+#ifndef _CHTRACKER_SONG_HXX
+#define _CHTRACKER_SONG_HXX
+
+#include "channel.hxx"
+#include "order.hxx"
+
+/**
+ * Everything a .cht file holds. Songs don't share any state, so several can
+ * be loaded, played and rendered at once.
+ */
+struct song {
+    orderStorage orders = orderStorage(32);
+    orderIndexStorage indexes;
+    instrumentStorage instruments;
+    unsigned short tempo = 960;
+    unsigned short patternLength = 32;
+};
+
+#endif
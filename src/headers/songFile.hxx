@@ -0,0 +1,37 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/headers/songFile.hxx
+  This is a declaration file; For implementation see path
+  ./src/songFile.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+#ifndef _CHTRACKER_SONGFILE_HXX
+#define _CHTRACKER_SONGFILE_HXX
+
+#include <filesystem>
+#include "song.hxx"
+
+// Writes `source` as a .cht file in the current format. Returns 0 on success
+int saveSong(song &source, std::filesystem::path path);
+
+// Replaces `target` with the song in a .cht file. Files from before 0.5 have
+// one-byte counts and order indexes, and are still read. Returns 0 on
+// success; on failure errorText may be pointed at a message for the user.
+int loadSong(song &target, std::filesystem::path filePath, char *&errorText);
+
+#endif
@@ -22,7 +22,7 @@
 #ifndef _CHTRACKER_TIMER_HXX
 #define _CHTRACKER_TIMER_HXX
 
-#include <string>
+#include <utility>
 #include <vector>
 
 enum class timerStatus {
@@ -30,24 +30,42 @@ enum class timerStatus {
     complete
 };
 
+/**
+ * Handle returned by timerHandler::addTimer. The low 20 bits are the slot and
+ * the rest count how often the slot was reused, so a stale handle doesn't
+ * find somebody else's timer.
+ */
+typedef unsigned int timerID;
+
 struct timer {
-    std::string name;
-    unsigned int ticksLeft;
+    unsigned long long deadline;
     unsigned int staringTicksLeft;
+    unsigned int generation;
     timerStatus status;
+    bool used;
 };
 
 class timerHandler {
     private:
     std::vector<timer> timers;
-    std::vector<timer> erase_timers;
+    std::vector<unsigned int> freeSlots;
+    // Min-heap of deadlines. Entries of removed or reset timers are left in
+    // and skipped when they come up.
+    std::vector<std::pair<unsigned long long, timerID>> queue;
+    unsigned long long now = 0;
+    timer *find(timerID id);
+    const timer *find(timerID id) const;
+    void schedule(timerID id, unsigned int inXTicks);
+    bool isCurrent(const std::pair<unsigned long long, timerID> &entry) const;
     public:
-    void addTimer(std::string name, unsigned int in_x_ticks);
-    void tick();
-    bool isComplete(std::string name);
-    void resetTimer(std::string name, unsigned int inXTicks);
-    bool hasTimer(std::string name);
-    void removeTimer(std::string name);
+    timerID addTimer(unsigned int inXTicks);
+    void tick(unsigned int ticks = 1);
+    unsigned int ticksUntilNext();
+    bool isComplete(timerID id) const;
+    void resetTimer(timerID id, unsigned int inXTicks);
+    bool hasTimer(timerID id) const;
+    void removeTimer(timerID id);
+    unsigned int count() const;
 };
 
 #endif
\ No newline at end of file
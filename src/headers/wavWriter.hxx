@@ -0,0 +1,68 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/headers/wavWriter.hxx
+  This is a declaration file; For implementation see path
+  ./src/wavWriter.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+#ifndef _CHTRACKER_WAVWRITER_HXX
+#define _CHTRACKER_WAVWRITER_HXX
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Streams 16 bit mono PCM into a WAV file. Samples go through a fixed-size
+ * buffer, so memory use doesn't grow with the song. The RIFF sizes are
+ * patched in by close().
+ *
+ * A threaded writer fills one buffer while a second thread writes the other
+ * to disk.
+ */
+class wavWriter {
+    private:
+    std::ofstream file;
+    uint32_t dataBytes = 0;
+    bool threaded = false;
+    std::array<std::vector<unsigned char>, 2> buffers;
+    unsigned char filling = 0;
+    std::thread writer;
+    std::mutex lock;
+    std::condition_variable wake;
+    // The buffer that isn't filling is waiting for the writer thread
+    bool pending = false;
+    bool finishing = false;
+    bool failed = false;
+    void flush();
+    void writerLoop();
+    public:
+    static constexpr size_t bufferFrames = 65536;
+    bool open(const std::filesystem::path &path, unsigned int sampleRate, bool threaded = false);
+    void write(const short *samples, size_t frames);
+    bool close();
+    ~wavWriter();
+};
+
+#endif
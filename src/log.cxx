@@ -25,5 +25,6 @@ namespace cmd {
 namespace log {
 int level = 1;
 std::vector<struct log> logs;
+std::mutex mutex;
 } // namespace log
 } // namespace cmd
@@ -0,0 +1,145 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/mixer.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include "mixer.hxx"
+
+// SSE2 is part of x86-64, so it's always there. AVX2 is compiled in with a
+// target attribute and only used if the CPU says it has it.
+#if defined(__SSE2__)
+#define MIXER_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MIXER_AVX2
+#include <immintrin.h>
+#endif
+
+namespace mixer {
+
+static constexpr int32_t masterShift = 2;
+
+// Scalar kernels; these also finish off whatever the vector kernels leave
+
+static void accumulateScalar(int32_t *bus, const short *in, size_t frames) {
+    for(size_t i = 0; i < frames; i++) bus[i] += in[i];
+}
+
+static void saturateScalar(short *out, const int32_t *bus, size_t frames) {
+    for(size_t i = 0; i < frames; i++) {
+        out[i] = static_cast<short>(std::min(32767, std::max(-32767, bus[i] >> masterShift)));
+    }
+}
+
+#ifdef MIXER_SSE2
+static void accumulateSSE2(int32_t *bus, const short *in, size_t frames) {
+    size_t i = 0;
+    for(; i + 8 <= frames; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        // Sign extend by putting each sample in the top half and shifting down
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        __m128i *b = reinterpret_cast<__m128i *>(bus + i);
+        _mm_storeu_si128(b, _mm_add_epi32(_mm_loadu_si128(b), lo));
+        _mm_storeu_si128(b + 1, _mm_add_epi32(_mm_loadu_si128(b + 1), hi));
+    }
+    accumulateScalar(bus + i, in + i, frames - i);
+}
+
+static void saturateSSE2(short *out, const int32_t *bus, size_t frames) {
+    const __m128i floor = _mm_set1_epi16(-32767);
+    size_t i = 0;
+    for(; i + 8 <= frames; i += 8) {
+        const __m128i *b = reinterpret_cast<const __m128i *>(bus + i);
+        __m128i lo = _mm_srai_epi32(_mm_loadu_si128(b), masterShift);
+        __m128i hi = _mm_srai_epi32(_mm_loadu_si128(b + 1), masterShift);
+        __m128i x = _mm_max_epi16(_mm_packs_epi32(lo, hi), floor);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), x);
+    }
+    saturateScalar(out + i, bus + i, frames - i);
+}
+#endif
+
+#ifdef MIXER_AVX2
+__attribute__((target("avx2")))
+static void accumulateAVX2(int32_t *bus, const short *in, size_t frames) {
+    size_t i = 0;
+    for(; i + 16 <= frames; i += 16) {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 8)));
+        __m256i *b = reinterpret_cast<__m256i *>(bus + i);
+        _mm256_storeu_si256(b, _mm256_add_epi32(_mm256_loadu_si256(b), lo));
+        _mm256_storeu_si256(b + 1, _mm256_add_epi32(_mm256_loadu_si256(b + 1), hi));
+    }
+    accumulateScalar(bus + i, in + i, frames - i);
+}
+
+__attribute__((target("avx2")))
+static void saturateAVX2(short *out, const int32_t *bus, size_t frames) {
+    const __m256i floor = _mm256_set1_epi16(-32767);
+    size_t i = 0;
+    for(; i + 16 <= frames; i += 16) {
+        const __m256i *b = reinterpret_cast<const __m256i *>(bus + i);
+        __m256i lo = _mm256_srai_epi32(_mm256_loadu_si256(b), masterShift);
+        __m256i hi = _mm256_srai_epi32(_mm256_loadu_si256(b + 1), masterShift);
+        // packs works within 128-bit lanes, so put the quarters back in order
+        __m256i x = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+        x = _mm256_max_epi16(x, floor);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), x);
+    }
+    saturateScalar(out + i, bus + i, frames - i);
+}
+#endif
+
+struct kernels {
+    void (*accumulate)(int32_t *, const short *, size_t);
+    void (*saturate)(short *, const int32_t *, size_t);
+    const char *name;
+};
+
+static kernels pickKernels() {
+#ifdef MIXER_AVX2
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) return {accumulateAVX2, saturateAVX2, "AVX2"};
+#endif
+#ifdef MIXER_SSE2
+    return {accumulateSSE2, saturateSSE2, "SSE2"};
+#else
+    return {accumulateScalar, saturateScalar, "scalar"};
+#endif
+}
+
+static const kernels selected = pickKernels();
+
+void accumulate(int32_t *bus, const short *in, size_t frames) {
+    selected.accumulate(bus, in, frames);
+}
+
+void saturate(short *out, const int32_t *bus, size_t frames) {
+    selected.saturate(out, bus, frames);
+}
+
+const char *kernelName() {
+    return selected.name;
+}
+
+} // namespace mixer
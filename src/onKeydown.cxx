@@ -65,6 +65,11 @@ void onOpenMenu(CursorPos &p) {
 int saveFile(std::filesystem::path);
 int loadFile(std::filesystem::path);
 int renderTo(std::filesystem::path);
+int startRender(std::filesystem::path);
+bool renderInProgress();
+void cancelRender();
+void logCallbackTiming();
+void resetCallbackTiming();
 #endif
 
 void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
@@ -87,6 +92,11 @@ void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
    *     Filename editor binds     *
    *                               *
    ********************************/
+  if (currentMenu == GlobalMenus::render_menu && renderInProgress()) {
+    if (code == SDLK_ESCAPE)
+      cancelRender();
+    return;
+  }
   if (currentMenu == GlobalMenus::save_file_menu ||
       currentMenu == GlobalMenus::render_menu) {
     if (code == SDLK_ESCAPE) {
@@ -122,14 +132,14 @@ void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
             hasUnsavedChanges = false;
           };
         } else {
-          int exit_code = renderTo(path);
+          // The render menu shows progress until the render finishes
+          int exit_code = startRender(path);
           if (exit_code) {
             fileMenuError = const_cast<char *>("Refused to render to the file");
             currentMenu = GlobalMenus::file_menu;
             onOpenMenu(cursorPosition);
           } else {
-            currentMenu = GlobalMenus::pattern_menu;
-            onOpenMenu(cursorPosition);
+            cursorPosition.subMenu = 0;
           };
         }
       } catch (std::filesystem::filesystem_error &) {
@@ -176,6 +186,15 @@ void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
       cmd::log::critical("Debug menu critical log");
       break;
     }
+    case 't': {
+      logCallbackTiming();
+      break;
+    }
+    case 'z': {
+      cmd::log::notice("Debug menu reset the audio callback timing");
+      resetCallbackTiming();
+      break;
+    }
     case 'f': {
       cmd::log::warning("Debug menu froze/unfroze audio");
       freezeAudio = !freezeAudio;
@@ -363,10 +382,11 @@ void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
     if (!freezeAudio) {
       playAudio = !playAudio;
       if (playAudio) {
-        for (unsigned char i = 0; i < instrumentSystem.inst_count(); i++) {
-          unsigned char patternIndex = indexes.at(audio_pattern)->at(i);
-          row *currentRow = orders.at(i)->at(patternIndex)->at(0);
-          instrumentSystem.at(i)->set_row(*currentRow);
+        for (unsigned short i = 0; i < instrumentSystem.inst_count(); i++) {
+          unsigned short patternIndex = indexes.at(audio_pattern)->at(i);
+          instrumentSystem.at(i)->set_row(
+              orders.at(i)->view(patternIndex)->get(0));
+          instrumentSystem.refreshVoice(i);
         }
       }
     }
@@ -453,8 +473,8 @@ void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
       ofn.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT;
 
       if (GetSaveFileName(&ofn) == TRUE) {
-        if(renderTo(ofn.lpstrFile) == 0) {
-          currentMenu = GlobalMenus::pattern_menu;
+        if(startRender(ofn.lpstrFile) == 0) {
+          currentMenu = GlobalMenus::render_menu;
           onOpenMenu(cursorPosition);
         } else if (fileMenu_errorText[0] == 0) {
           fileMenu_errorText = const_cast<char*>("Couldn't render to the file");
@@ -493,6 +513,19 @@ void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
         viewMode++;
       break;
     }
+    case '[':
+    case ']': {
+      if (orders.tableCount() == 0)
+        break;
+      unsigned short instrument =
+          cursorPosition.x /
+          patternMenu_instrumentVariableCount[static_cast<size_t>(viewMode)];
+      orders.at(instrument)
+          ->at(indexes.at(currentlyViewedOrder)->at(instrument))
+          ->transpose(code == ']' ? 1 : -1);
+      hasUnsavedChanges = true;
+      break;
+    }
     case 'u': {
       if (viewMode > 0) {
         viewMode--;
@@ -503,15 +536,20 @@ void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
     }
     if (orders.tableCount() < 1)
       return;
-    unsigned char selectedInstrument =
+    unsigned short selectedInstrument =
         cursorPosition.x /
         patternMenu_instrumentVariableCount[static_cast<size_t>(viewMode)];
-    unsigned char selectedVariable =
+    unsigned short selectedVariable =
         cursorPosition.x %
         patternMenu_instrumentVariableCount[static_cast<size_t>(viewMode)];
-    row *r = orders.at(selectedInstrument)
-                 ->at(indexes.at(currentlyViewedOrder)->at(selectedInstrument))
-                 ->at(cursorPosition.y);
+    // Edits a copy of the row under the cursor, stored back at the end if it
+    // changed (storing copies the pattern if it's shared)
+    instrumentOrderTable *table = orders.at(selectedInstrument);
+    unsigned short editedPattern =
+        indexes.at(currentlyViewedOrder)->at(selectedInstrument);
+    unsigned short editedRow = cursorPosition.y;
+    row edited = table->view(editedPattern)->get(editedRow);
+    row *r = &edited;
     if (selectedVariable == 0) {
       bool moveDown = true;
       switch (code) {
@@ -700,6 +738,8 @@ void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
         hasUnsavedChanges = true;
       }
     }
+    if (edited != table->view(editedPattern)->get(editedRow))
+      table->at(editedPattern)->set(editedRow, edited);
     return;
   }
   /***************************************
@@ -710,7 +750,7 @@ void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
   switch (code) {
   case 'z': {
     if (currentMenu == GlobalMenus::instrument_menu &&
-        instrumentSystem.inst_count() < 254) {
+        instrumentSystem.inst_count() < 0xFFFE) {
       instrumentSystem.add_inst(audioChannelType::null);
       orders.at(orders.addTable())->add_order();
       indexes.addInst();
@@ -741,7 +781,7 @@ void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
       if (orders.at(cursorPosition.y)->order_count() < 2)
         break;
       for (unsigned short i = 0; i < indexes.rowCount(); i++) {
-        unsigned char a = indexes.at(i)->at(cursorPosition.y);
+        unsigned short a = indexes.at(i)->at(cursorPosition.y);
         if (a > cursorPosition.x) {
           indexes.at(i)->decrement(cursorPosition.y);
         } else if (a == cursorPosition.x) {
@@ -758,6 +798,7 @@ void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
     if (currentMenu == GlobalMenus::instrument_menu &&
         instrumentSystem.inst_count() > 0) {
       instrumentSystem.at(cursorPosition.y)->cycle_type();
+      instrumentSystem.refreshVoice(cursorPosition.y);
       hasUnsavedChanges = true;
     } else if (currentMenu == GlobalMenus::order_management_menu &&
                orders.tableCount() > 0) {
@@ -769,25 +810,10 @@ void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
         cursorPosition.x = 0;
         break;
       }
-      order *output = orders.at(cursorPosition.x)
-                          ->at(orders.at(cursorPosition.x)->add_order());
-      order *input =
-          orders.at(cursorPosition.selection.y)->at(cursorPosition.selection.x);
-      for (int i = 0; i < patternLength; i++) {
-        row *inputRow = input->at(i);
-        row *outputRow = output->at(i);
-        outputRow->feature = inputRow->feature;
-        outputRow->note = inputRow->note;
-        outputRow->octave = inputRow->octave;
-        outputRow->volume = inputRow->volume;
-        for (int j = 0;
-             j < 4 && static_cast<size_t>(j) < inputRow->effects.size() &&
-             static_cast<size_t>(j) < outputRow->effects.size();
-             j++) {
-          outputRow->effects.at(j).type = inputRow->effects.at(j).type;
-          outputRow->effects.at(j).effect = inputRow->effects.at(j).effect;
-        }
-      }
+      // Shared rather than copied; editing either copies it then
+      orders.at(cursorPosition.x)
+          ->add_shared_order(*orders.at(cursorPosition.selection.y),
+                             cursorPosition.selection.x);
       cursorPosition.selection.x = 0;
       cursorPosition.selection.y = 0;
       cursorPosition.subMenu = 0;
@@ -800,7 +826,7 @@ void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
   case 'w': {
     if (currentMenu == GlobalMenus::order_menu &&
         instrumentSystem.inst_count() > 0) {
-      if (indexes.at(cursorPosition.y)->at(cursorPosition.x) < 254) {
+      if (indexes.at(cursorPosition.y)->at(cursorPosition.x) < 0xFFFE) {
         indexes.at(cursorPosition.y)->increment(cursorPosition.x);
         hasUnsavedChanges = true;
       }
@@ -821,7 +847,7 @@ void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
           hasUnsavedChanges = true;
         }
       } else {
-        if (patternLength < 256) {
+        if (patternLength < 0xFFFF) {
           patternLength++;
           orders.setRowCount(patternLength);
           hasUnsavedChanges = true;
@@ -859,6 +885,26 @@ void onSDLKeyDown(const SDL_Event *event, int &quit, GlobalMenus &currentMenu,
     }
     break;
   }
+  case 'd': {
+    if (currentMenu == GlobalMenus::order_management_menu &&
+        cursorPosition.subMenu == 0 && orders.tableCount() > 0) {
+      // The audio callback reads patterns through the index rows, which
+      // don't match the tables partway through
+      bool audioWasRunning =
+          SDL_GetAudioDeviceStatus(audio::deviceID) == SDL_AUDIO_PLAYING;
+      SDL_PauseAudioDevice(audio::deviceID, 1);
+      size_t removed = orders.deduplicate(indexes);
+      if (audioWasRunning)
+        SDL_PauseAudioDevice(audio::deviceID, 0);
+      cmd::log::notice("Removed {} duplicate patterns", removed);
+      if (removed == 0)
+        break;
+      cursorPosition.x = 0;
+      cursorPosition.y = 0;
+      hasUnsavedChanges = true;
+    }
+    break;
+  }
   }
   /**************************************
    * Windows file menu drive navigation *
@@ -18,7 +18,9 @@
   Chase Taylor @ creset200@gmail.com
 */
 
+#include <algorithm>
 #include <stdexcept>
+#include <unordered_map>
 #include "order.hxx"
 
 // effect
@@ -38,147 +40,365 @@ struct effectValues effectTo4Values(effect e) {
     return {a,b,c,d};
 }
 
+bool effect::operator==(const struct effect &other) const {
+    return type == other.type && effect == other.effect;
+}
+
 // row
+bool row::operator==(const row &other) const {
+    return feature == other.feature && note == other.note && octave == other.octave &&
+           volume == other.volume && effects == other.effects;
+}
+bool row::operator!=(const row &other) const {
+    return !(*this == other);
+}
 
+// FNV-1a, a column at a time
+template <typename T>
+static void hashColumn(uint64_t &hash, const std::vector<T> &column) {
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(column.data());
+    for(size_t i = 0; i < column.size() * sizeof(T); i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3;
+    }
+}
 
 // order
-order::order(unsigned short size): rows(size) {}
+order::order(unsigned short size) {
+    setRowCount(size);
+}
 
 void order::setRowCount(unsigned short size) {
-    rows.resize(size);
+    hash.value.store(0, std::memory_order_relaxed);
+    rows = size;
+    size_t kept = firstEventFrom(size);
+    while(eventCount() > kept) eraseEvent(eventCount() - 1);
 }
 
 unsigned short order::rowCount() const {
-    return rows.size();
+    return rows;
 }
 
-row* order::at(unsigned short idx) {
-    return &rows.at(idx);
+// Makes room for an event at `event`, filled in with a default row
+void order::insertEvent(size_t event, unsigned short idx) {
+    const row blank;
+    eventRows.insert(eventRows.begin() + event, idx);
+    features.insert(features.begin() + event, blank.feature);
+    notes.insert(notes.begin() + event, blank.note);
+    octaves.insert(octaves.begin() + event, blank.octave);
+    volumes.insert(volumes.begin() + event, blank.volume);
+    for(unsigned char i = 0; i < 4; i++) {
+        effectTypeColumns[i].insert(effectTypeColumns[i].begin() + event, blank.effects[i].type);
+        effectValueColumns[i].insert(effectValueColumns[i].begin() + event, blank.effects[i].effect);
+    }
 }
 
+void order::eraseEvent(size_t event) {
+    eventRows.erase(eventRows.begin() + event);
+    features.erase(features.begin() + event);
+    notes.erase(notes.begin() + event);
+    octaves.erase(octaves.begin() + event);
+    volumes.erase(volumes.begin() + event);
+    for(unsigned char i = 0; i < 4; i++) {
+        effectTypeColumns[i].erase(effectTypeColumns[i].begin() + event);
+        effectValueColumns[i].erase(effectValueColumns[i].begin() + event);
+    }
+}
+
+row order::get(unsigned short idx) const {
+    if(idx >= rowCount()) throw std::out_of_range("order::get");
+    size_t event = firstEventFrom(idx);
+    if(event == eventCount() || eventRows[event] != idx) return row();
+    return eventAt(event);
+}
+
+void order::set(unsigned short idx, const row &r) {
+    if(idx >= rowCount()) throw std::out_of_range("order::set");
+    hash.value.store(0, std::memory_order_relaxed);
+    size_t event = firstEventFrom(idx);
+    bool found = event < eventCount() && eventRows[event] == idx;
+    if(r == row()) {
+        if(found) eraseEvent(event);
+        return;
+    }
+    if(!found) insertEvent(event, idx);
+    features[event] = r.feature;
+    notes[event] = r.note;
+    octaves[event] = r.octave;
+    volumes[event] = r.volume;
+    for(unsigned char i = 0; i < 4; i++) {
+        effectTypeColumns[i][event] = r.effects[i].type;
+        effectValueColumns[i][event] = r.effects[i].effect;
+    }
+}
+
+size_t order::eventCount() const {
+    return eventRows.size();
+}
+
+size_t order::firstEventFrom(unsigned short idx) const {
+    return std::lower_bound(eventRows.begin(), eventRows.end(), idx) - eventRows.begin();
+}
+
+unsigned short order::eventRow(size_t event) const {
+    return eventRows.at(event);
+}
+
+row order::eventAt(size_t event) const {
+    if(event >= eventCount()) throw std::out_of_range("order::eventAt");
+    row r;
+    r.feature = features[event];
+    r.note = notes[event];
+    r.octave = octaves[event];
+    r.volume = volumes[event];
+    for(unsigned char i = 0; i < 4; i++) r.effects[i] = {effectTypeColumns[i][event], effectValueColumns[i][event]};
+    return r;
+}
+
+const unsigned short *order::eventRowColumn() const {
+    return eventRows.data();
+}
+
+const rowFeature *order::featureColumn() const {
+    return features.data();
+}
+
+const char *order::noteColumn() const {
+    return notes.data();
+}
+
+const char *order::octaveColumn() const {
+    return octaves.data();
+}
+
+const unsigned char *order::volumeColumn() const {
+    return volumes.data();
+}
+
+const effectTypes *order::effectTypeColumn(unsigned char effectIdx) const {
+    return effectTypeColumns.at(effectIdx).data();
+}
+
+const unsigned short *order::effectValueColumn(unsigned char effectIdx) const {
+    return effectValueColumns.at(effectIdx).data();
+}
+
+// Notes are 'A' to 'L' (12 to an octave) in octaves 0 to 15, the most a row
+// stores. Only note rows change, and they stay note rows, so the events stay
+// where they are.
+void order::transpose(int semitones) {
+    constexpr int highest = 16 * 12 - 1;
+    hash.value.store(0, std::memory_order_relaxed);
+    for(size_t i = 0; i < eventCount(); i++) {
+        if(features[i] != rowFeature::note) continue;
+        int semitone = (notes[i] - 'A') + octaves[i] * 12 + semitones;
+        semitone = std::min(highest, std::max(0, semitone));
+        notes[i] = 'A' + semitone % 12;
+        octaves[i] = semitone / 12;
+    }
+}
+
+order::hashCache::hashCache(const hashCache &other): value(other.value.load(std::memory_order_relaxed)) {}
+order::hashCache &order::hashCache::operator=(const hashCache &other) {
+    value.store(other.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return *this;
+}
+
+uint64_t order::contentHash() const {
+    uint64_t cached = hash.value.load(std::memory_order_relaxed);
+    if(cached != 0) return cached;
+    uint64_t h = 0xcbf29ce484222325;
+    hashColumn(h, std::vector<unsigned short>{rows});
+    hashColumn(h, eventRows);
+    hashColumn(h, features);
+    hashColumn(h, notes);
+    hashColumn(h, octaves);
+    hashColumn(h, volumes);
+    for(unsigned char i = 0; i < 4; i++) {
+        hashColumn(h, effectTypeColumns[i]);
+        hashColumn(h, effectValueColumns[i]);
+    }
+    // 0 means not worked out yet
+    if(h == 0) h = 1;
+    hash.value.store(h, std::memory_order_relaxed);
+    return h;
+}
+
+bool order::operator==(const order &other) const {
+    if(this == &other) return true;
+    if(contentHash() != other.contentHash()) return false;
+    return rows == other.rows && eventRows == other.eventRows && features == other.features &&
+           notes == other.notes && octaves == other.octaves && volumes == other.volumes &&
+           effectTypeColumns == other.effectTypeColumns && effectValueColumns == other.effectValueColumns;
+}
 
 // instrumentOrderTable
 instrumentOrderTable::instrumentOrderTable(unsigned short size): rowCount(size) {};
-unsigned char instrumentOrderTable::add_order() {
-    orders.push_back(order(rowCount));
+unsigned short instrumentOrderTable::add_order() {
+    if(orders.size() >= 0xFFFF) throw std::length_error("instrumentOrderTable::add_order");
+    orders.push_back(std::make_shared<order>(rowCount));
     return orders.size()-1;
 }
-unsigned char instrumentOrderTable::order_count() const {
+unsigned short instrumentOrderTable::add_shared_order(const instrumentOrderTable &source, unsigned short idx) {
+    if(orders.size() >= 0xFFFF) throw std::length_error("instrumentOrderTable::add_shared_order");
+    orders.push_back(source.orders.at(idx));
+    return orders.size()-1;
+}
+unsigned short instrumentOrderTable::order_count() const {
     return orders.size();
 }
-void instrumentOrderTable::remove_order(unsigned char idx) {
+void instrumentOrderTable::remove_order(unsigned short idx) {
     if(idx>=order_count()) throw std::out_of_range("instrumentOrderTable::remove_order");
-
-    for(unsigned char i = order_count()-1; i>idx; i--) {
-        order o = orders.back();
-        orders.pop_back();
-        erase_orders.push_back(o);
-    }
-    orders.pop_back();
-    while(!erase_orders.empty()) {
-        order o = erase_orders.back();
-        erase_orders.pop_back();
-        orders.push_back(o);
-    }
+    orders.erase(orders.begin() + idx);
 }
 void instrumentOrderTable::set_row_count(unsigned short size) {
     rowCount = size;
-    for(unsigned char i = 0; i < orders.size(); i++) {
-        orders.at(i).setRowCount(size);
+    for(unsigned short i = 0; i < order_count(); i++) {
+        if(view(i)->rowCount() != size) at(i)->setRowCount(size);
     }
 }
-order* instrumentOrderTable::at(unsigned char idx) {
-    return &orders.at(idx);
+order* instrumentOrderTable::at(unsigned short idx) {
+    std::shared_ptr<order> &pattern = orders.at(idx);
+    if(pattern.use_count() > 1) pattern = std::make_shared<order>(*pattern);
+    return pattern.get();
+}
+const order* instrumentOrderTable::view(unsigned short idx) const {
+    return orders.at(idx).get();
+}
+bool instrumentOrderTable::is_shared(unsigned short idx) const {
+    return orders.at(idx).use_count() > 1;
 }
 
 
 // orderStorage
 orderStorage::orderStorage(unsigned short size): row_count(size) {}
-unsigned char orderStorage::addTable() {
-    orderTables.push_back(instrumentOrderTable(row_count));
+unsigned short orderStorage::addTable() {
+    if(orderTables.size() >= 0xFFFF) throw std::length_error("orderStorage::addTable");
+    orderTables.emplace_back(row_count);
     return orderTables.size()-1;
 }
-unsigned char orderStorage::tableCount() const {
+unsigned short orderStorage::tableCount() const {
     return orderTables.size();
 }
-void orderStorage::removeTable(unsigned char idx) {
+void orderStorage::removeTable(unsigned short idx) {
     if(idx>=tableCount()) throw std::out_of_range("orderStorage::remove_table");
-
-    for(unsigned char i = tableCount()-1; i>idx; i--) {
-        instrumentOrderTable table = orderTables.back();
-        orderTables.pop_back();
-        erase_orderTables.push_back(table);
-    }
-    orderTables.pop_back();
-    while(!erase_orderTables.empty()) {
-        instrumentOrderTable table = erase_orderTables.back();
-        erase_orderTables.pop_back();
-        orderTables.push_back(table);
-    }
+    orderTables.erase(orderTables.begin() + idx);
 }
 void orderStorage::setRowCount(unsigned short size) {
     row_count = size;
-    for(unsigned long i = 0; i < orderTables.size(); i++) {
+    for(size_t i = 0; i < orderTables.size(); i++) {
         orderTables.at(i).set_row_count(size);
     }
 }
 unsigned short orderStorage::rowCount() const {
     return row_count;
 }
-instrumentOrderTable* orderStorage::at(unsigned char idx) {
+instrumentOrderTable* orderStorage::at(unsigned short idx) {
     return &orderTables.at(idx);
 }
+size_t orderStorage::intern() {
+    std::unordered_map<uint64_t, std::vector<std::shared_ptr<order>>> seen;
+    size_t joined = 0;
+    for(size_t t = 0; t < orderTables.size(); t++) {
+        std::vector<std::shared_ptr<order>> &patterns = orderTables[t].orders;
+        for(size_t i = 0; i < patterns.size(); i++) {
+            std::vector<std::shared_ptr<order>> &sameHash = seen[patterns[i]->contentHash()];
+            auto match = std::find_if(sameHash.begin(), sameHash.end(),
+                                      [&](const std::shared_ptr<order> &p) { return *p == *patterns[i]; });
+            if(match == sameHash.end()) {
+                sameHash.push_back(patterns[i]);
+            } else if(*match != patterns[i]) {
+                patterns[i] = *match;
+                joined++;
+            }
+        }
+    }
+    return joined;
+}
+size_t orderStorage::deduplicate(orderIndexStorage &indexes) {
+    // Works out the new tables and index rows first, then swaps them in, so
+    // the song is only ever in its old state or its new one
+    std::unordered_map<uint64_t, std::vector<std::shared_ptr<order>>> seen;
+    std::vector<std::vector<std::shared_ptr<order>>> kept(orderTables.size());
+    // Where each pattern ends up once the repeats are gone
+    std::vector<std::vector<unsigned short>> remap(orderTables.size());
+    size_t removed = 0;
+    for(size_t t = 0; t < orderTables.size(); t++) {
+        const std::vector<std::shared_ptr<order>> &patterns = orderTables[t].orders;
+        std::unordered_map<const order *, unsigned short> first;
+        remap[t].resize(patterns.size());
+        for(size_t i = 0; i < patterns.size(); i++) {
+            // The first pattern with the same rows, in any table
+            std::vector<std::shared_ptr<order>> &sameHash = seen[patterns[i]->contentHash()];
+            auto match = std::find_if(sameHash.begin(), sameHash.end(),
+                                      [&](const std::shared_ptr<order> &p) { return *p == *patterns[i]; });
+            if(match == sameHash.end()) match = sameHash.insert(sameHash.end(), patterns[i]);
+            auto found = first.find(match->get());
+            if(found == first.end()) {
+                first.emplace(match->get(), kept[t].size());
+                remap[t][i] = kept[t].size();
+                kept[t].push_back(*match);
+            } else {
+                remap[t][i] = found->second;
+                removed++;
+            }
+        }
+    }
+    std::vector<std::vector<unsigned short>> newIndexes(indexes.rowCount());
+    for(unsigned short r = 0; r < indexes.rowCount(); r++) {
+        orderIndexRow *indexRow = indexes.at(r);
+        for(unsigned short t = 0; t < indexRow->instCount(); t++) {
+            unsigned short idx = indexRow->at(t);
+            newIndexes[r].push_back(t < remap.size() && idx < remap[t].size() ? remap[t][idx] : idx);
+        }
+    }
+
+    for(size_t t = 0; t < orderTables.size(); t++) orderTables[t].orders.swap(kept[t]);
+    for(unsigned short r = 0; r < indexes.rowCount(); r++) {
+        for(unsigned short t = 0; t < newIndexes[r].size(); t++) indexes.at(r)->set(t, newIndexes[r][t]);
+    }
+    return removed;
+}
 
 // orderIndexRow
 
-unsigned char orderIndexRow::addInst() {
+unsigned short orderIndexRow::addInst() {
     indexes.push_back(0);
     return indexes.size()-1;
 }
-unsigned char orderIndexRow::instCount() const {
+unsigned short orderIndexRow::instCount() const {
     return indexes.size();
 }
-void orderIndexRow::removeInst(unsigned char idx) {
+void orderIndexRow::removeInst(unsigned short idx) {
     if(idx>=instCount()) throw std::out_of_range("orderIndexRow::removeInst");
-
-    for(unsigned char i = instCount()-1; i>idx; i--) {
-        unsigned char index = indexes.back();
-        indexes.pop_back();
-        erase_indexes.push_back(index);
-    }
-    indexes.pop_back();
-    while(!erase_indexes.empty()) {
-        unsigned char index = erase_indexes.back();
-        erase_indexes.pop_back();
-        indexes.push_back(index);
-    }
+    indexes.erase(indexes.begin() + idx);
 }
-unsigned char orderIndexRow::at(unsigned char idx) {
+unsigned short orderIndexRow::at(unsigned short idx) {
     return indexes.at(idx);
 }
-void orderIndexRow::set(unsigned char idx, unsigned char value) {
+void orderIndexRow::set(unsigned short idx, unsigned short value) {
     if(idx >= instCount()) throw std::out_of_range("orderIndexRow::set");
     indexes[idx] = value;
 }
-void orderIndexRow::increment(unsigned char idx) {
+void orderIndexRow::increment(unsigned short idx) {
     if(idx >= instCount()) throw std::out_of_range("orderIndexRow::increment");
     indexes[idx]++;
 }
-void orderIndexRow::decrement(unsigned char idx) {
+void orderIndexRow::decrement(unsigned short idx) {
     if(idx >= instCount()) throw std::out_of_range("orderIndexRow::decrement");
     indexes[idx]--;
 }
 // orderIndexStorage
 
-unsigned char orderIndexStorage::addInst() {
-    unsigned char temp = 255;
-    for(unsigned short i = 0; i < rows.size(); i++) {
+unsigned short orderIndexStorage::addInst() {
+    unsigned short temp = 0xFFFF;
+    for(size_t i = 0; i < rows.size(); i++) {
         temp = rows.at(i).addInst();
     }
     return temp;
 }
 
-unsigned char orderIndexStorage::instCount(unsigned char fallback) const {
+unsigned short orderIndexStorage::instCount(unsigned short fallback) const {
     if(rows.size()==0) return fallback;
     try {
         return rows.at(0).instCount();
@@ -187,16 +407,17 @@ unsigned char orderIndexStorage::instCount(unsigned char fallback) const {
     }
 }
 
-void orderIndexStorage::removeInst(unsigned char idx) {
+void orderIndexStorage::removeInst(unsigned short idx) {
     for(unsigned short i = 0; i < rowCount(); i++) {
         rows.at(i).removeInst(idx);
     }
 }
 
 unsigned short orderIndexStorage::addRow() {
+    if(rows.size() >= 0xFFFF) throw std::length_error("orderIndexStorage::addRow");
     orderIndexRow row;
-    for(unsigned char i=0; i<instCount(0); i++) row.addInst();
-    rows.push_back(row);
+    for(unsigned short i=0; i<instCount(0); i++) row.addInst();
+    rows.push_back(std::move(row));
     return rows.size()-1;
 }
 
@@ -206,18 +427,7 @@ unsigned short orderIndexStorage::rowCount() const {
 
 void orderIndexStorage::removeRow(unsigned short idx) {
     if(idx>=rowCount()) throw std::out_of_range("orderIndexStorage::removeRow");
-
-    for(unsigned char i = rowCount()-1; i>idx; i--) {
-        orderIndexRow row = rows.back();
-        rows.pop_back();
-        erase_rows.push_back(row);
-    }
-    rows.pop_back();
-    while(!erase_rows.empty()) {
-        orderIndexRow row = erase_rows.back();
-        erase_rows.pop_back();
-        rows.push_back(row);
-    }
+    rows.erase(rows.begin() + idx);
 }
 
 orderIndexRow* orderIndexStorage::at(unsigned short idx) {
@@ -0,0 +1,253 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/player.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include "mixer.hxx"
+#include "player.hxx"
+
+static constexpr size_t blockLength = 1024;
+
+player::player(song &source): source(source) {}
+
+// Moves a position to the next row, wrapping at the end of the song
+void player::nextRow(unsigned short &patternIdx, unsigned short &rowIdx) {
+    if(rowIdx >= source.orders.at(0)->view(0)->rowCount() - 1) {
+        rowIdx = 0;
+        if(patternIdx >= source.indexes.rowCount() - 1) patternIdx = 0;
+        else patternIdx++;
+    } else rowIdx++;
+}
+
+void player::advanceRow() {
+    nextRow(currentPattern, currentRow);
+}
+
+// Applies due events to one instrument at the given position. Instruments
+// don't share any state, so different instruments can be dispatched on
+// different threads. Blank rows don't change a channel, so only rows with an
+// event are set. The instrument's cursor is checked against the pattern
+// rather than trusted, and searched for again when it's wrong (after a seek,
+// a pattern change or an edit).
+void player::dispatch(unsigned short instrument, const sequencerEvents &events,
+                      unsigned short patternIdx, unsigned short rowIdx) {
+    if(events.row) {
+        unsigned short patternIndex = source.indexes.at(patternIdx)->at(instrument);
+        const order *pattern = source.orders.at(instrument)->view(patternIndex);
+        bool cursorKnown = instrument < eventCursors.size();
+        size_t event = cursorKnown ? eventCursors[instrument] : 0;
+        if(!cursorKnown || event > pattern->eventCount() ||
+           (event < pattern->eventCount() && pattern->eventRow(event) < rowIdx) ||
+           (event > 0 && pattern->eventRow(event - 1) >= rowIdx)) {
+            event = pattern->firstEventFrom(rowIdx);
+        }
+        if(event < pattern->eventCount() && pattern->eventRow(event) == rowIdx) {
+            source.instruments.at(instrument)->set_row(pattern->eventAt(event));
+            event++;
+        }
+        if(cursorKnown) eventCursors[instrument] = event;
+    }
+    if(events.effect) source.instruments.at(instrument)->applyFx();
+    if(events.arpeggio) source.instruments.at(instrument)->applyArpeggio();
+    if(events.row || events.effect || events.arpeggio) source.instruments.refreshVoice(instrument);
+}
+
+void player::start(unsigned int sampleRate) {
+    clock.start(source.tempo, sampleRate);
+}
+
+void player::stop() {
+    clock.stop();
+}
+
+bool player::isRunning() const {
+    return clock.isRunning();
+}
+
+void player::setPosition(unsigned short patternIdx, unsigned short rowIdx) {
+    currentPattern = patternIdx;
+    currentRow = rowIdx;
+}
+
+unsigned short player::getPattern() const {
+    return currentPattern;
+}
+
+unsigned short player::getRow() const {
+    return currentRow;
+}
+
+// Cuts every instrument and clears its effects
+void player::silence() {
+    row dummyRow = {rowFeature::note_cut, 'A', 4, 0, {}};
+    for(effect &e : dummyRow.effects) e = {effectTypes::arpeggio, 0};
+    for(unsigned short i = 0; i < source.instruments.inst_count(); i++) {
+        source.instruments.at(i)->set_row(dummyRow);
+        source.instruments.refreshVoice(i);
+    }
+}
+
+// Silences everything, then loads the rows at the play position
+void player::cue() {
+    eventCursors.assign(source.instruments.inst_count(), 0);
+    silence();
+    sequencerEvents events;
+    events.row = true;
+    for(unsigned short i = 0; i < source.instruments.inst_count(); i++) dispatch(i, events, currentPattern, currentRow);
+}
+
+// Mixes `frames` samples of every instrument into `out`. Instruments render
+// whole blocks at a time; a block ends wherever the next event is due, so rows
+// and effects still land on the exact sample they did before. Every block goes
+// onto a 32-bit bus that's only saturated to 16 bits once, at the end.
+// Only active instruments are rendered; when there are none, the block is
+// just zeroed.
+void player::mix(short *out, size_t frames) {
+    std::array<short, blockLength> block;
+    std::array<int32_t, blockLength> bus;
+    size_t done = 0;
+    eventCursors.resize(source.instruments.inst_count(), 0);
+    clock.setTempo(source.tempo);
+    while(done < frames) {
+        size_t length = std::min<size_t>({frames - done, blockLength, clock.samplesUntilEvent()});
+        if(source.instruments.activeCount() == 0) {
+            std::fill_n(out + done, length, 0);
+        } else {
+            std::fill_n(bus.begin(), length, 0);
+            for(unsigned short word = 0; word < source.instruments.activeWordCount(); word++) {
+                for(uint64_t bits = source.instruments.activeWord(word); bits != 0; bits &= bits - 1) {
+                    unsigned short i = word * 64 + __builtin_ctzll(bits);
+                    source.instruments.at(i)->render(block.data(), length);
+                    mixer::accumulate(bus.data(), block.data(), length);
+                }
+            }
+            mixer::saturate(out + done, bus.data(), length);
+        }
+        sequencerEvents events = clock.advance(length);
+        if(events.row) advanceRow();
+        for(unsigned short i = 0; i < source.instruments.inst_count(); i++) dispatch(i, events, currentPattern, currentRow);
+        done += length;
+    }
+}
+
+// A stretch of samples with no events in it, and the events that end it
+struct renderSegment {
+    size_t length;
+    sequencerEvents events;
+    unsigned short pattern;
+    unsigned short row;
+};
+
+// Mixes like mix(), sharing the instruments out between `threads` threads.
+// The sequencer first runs ahead on this thread to split the chunk into
+// segments. Each thread then renders its instruments one at a time, segment by
+// segment, applying the events in between, and adds them to a 32-bit bus of
+// its own. The buses are summed as integers afterwards, so the output doesn't
+// depend on the number of threads.
+// With `stems`, each instrument is rendered into its own buffer there, which
+// must hold at least `frames` samples; without, each thread reuses one
+// scratch buffer, so memory doesn't grow with the number of instruments.
+void player::render(short *out, size_t frames, unsigned int threads,
+                    std::vector<std::vector<short>> *stems) {
+    std::vector<renderSegment> segments;
+    size_t done = 0;
+    eventCursors.resize(source.instruments.inst_count(), 0);
+    clock.setTempo(source.tempo);
+    while(done < frames) {
+        size_t length = std::min<size_t>(frames - done, clock.samplesUntilEvent());
+        sequencerEvents events = clock.advance(length);
+        if(events.row) advanceRow();
+        segments.push_back({length, events, currentPattern, currentRow});
+        done += length;
+    }
+
+    unsigned short instrumentCount = source.instruments.inst_count();
+    threads = std::max(1u, threads);
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::vector<int32_t>> buses(threads);
+    auto work = [&](unsigned int first) {
+        try {
+            std::vector<int32_t> &bus = buses.at(first);
+            bus.assign(frames, 0);
+            std::vector<short> scratch(stems ? 0 : frames);
+            for(unsigned int i = first; i < instrumentCount; i += threads) {
+                short *start = stems ? stems->at(i).data() : scratch.data();
+                short *stem = start;
+                // Whether the instrument was active at all this chunk;
+                // silent ones aren't summed
+                bool sounded = false;
+                for(const renderSegment &segment : segments) {
+                    if(source.instruments.isActive(i)) {
+                        source.instruments.at(i)->render(stem, segment.length);
+                        sounded = true;
+                    } else {
+                        std::fill_n(stem, segment.length, 0);
+                    }
+                    stem += segment.length;
+                    dispatch(i, segment.events, segment.pattern, segment.row);
+                }
+                if(sounded) mixer::accumulate(bus.data(), start, frames);
+            }
+        } catch(...) {
+            errors.at(first) = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    for(unsigned int t = 1; t < threads; t++) workers.emplace_back(work, t);
+    work(0);
+    for(std::thread &worker : workers) worker.join();
+    for(std::exception_ptr &error : errors) {
+        if(error) std::rethrow_exception(error);
+    }
+
+    std::vector<int32_t> &total = buses.at(0);
+    for(unsigned int t = 1; t < threads; t++) {
+        for(size_t i = 0; i < frames; i++) total[i] += buses[t][i];
+    }
+    mixer::saturate(out, total.data(), frames);
+}
+
+// Runs the song through a sequencer of its own without synthesizing anything,
+// from the first row until it loops. Rows land exactly where a render at the
+// same rate puts them.
+songTiming player::measure(unsigned int sampleRate) {
+    songTiming timing;
+    if(source.orders.tableCount() == 0 || source.indexes.rowCount() == 0) return timing;
+    sequencer dryRun;
+    dryRun.start(source.tempo, sampleRate);
+    unsigned short patternIdx = 0;
+    unsigned short rowIdx = 0;
+    timing.orderStarts.push_back(0);
+    size_t time = 0;
+    while(true) {
+        unsigned int length = dryRun.samplesUntilEvent();
+        time += length;
+        if(!dryRun.advance(length).row) continue;
+        nextRow(patternIdx, rowIdx);
+        if(rowIdx != 0) continue;
+        if(patternIdx == 0) break;
+        timing.orderStarts.push_back(time);
+    }
+    timing.length = time;
+    return timing;
+}
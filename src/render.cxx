@@ -0,0 +1,197 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/render.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "mixer.hxx"
+#include "render.hxx"
+#include "wavWriter.hxx"
+
+// Instruments are copied fresh by type; the copies don't need (and shouldn't
+// race on) whatever the live ones are playing.
+renderJob::renderJob(song &source, const std::filesystem::path &path, unsigned int threads, bool stems):
+    engine(snapshot), path(path), threads(threads), stems(stems) {
+    snapshot.orders = source.orders;
+    snapshot.indexes = source.indexes;
+    snapshot.tempo = source.tempo;
+    snapshot.patternLength = source.patternLength;
+    for(unsigned short i = 0; i < source.instruments.inst_count(); i++) {
+        snapshot.instruments.add_inst(source.instruments.at(i)->get_type());
+    }
+    snapshot.instruments.setSampleRate(sampleRate);
+    timing = engine.measure(sampleRate);
+}
+
+// Scales a stem to the master volume, the same way it's heard in the mix, and
+// writes it out
+static void writeStem(wavWriter &file, const short *stem, size_t frames) {
+    static constexpr size_t blockLength = 1024;
+    std::array<int32_t, blockLength> bus;
+    std::array<short, blockLength> out;
+    for(size_t offset = 0; offset < frames; offset += blockLength) {
+        size_t length = std::min(blockLength, frames - offset);
+        std::fill_n(bus.begin(), length, 0);
+        mixer::accumulate(bus.data(), stem + offset, length);
+        mixer::saturate(out.data(), bus.data(), length);
+        file.write(out.data(), length);
+    }
+}
+
+renderJob::~renderJob() {
+    cancel();
+    if(worker.joinable()) worker.join();
+}
+
+void renderJob::run() {
+    try {
+        wavWriter file;
+        if(!file.open(path, sampleRate, true)) {
+            error = "Couldn't open the file";
+            status = renderStatus::failed;
+            return;
+        }
+        unsigned short instrumentCount = snapshot.instruments.inst_count();
+        // The stem writers aren't threaded; the mix's writer already keeps
+        // the disk busy, and a thread each would be one per instrument.
+        std::vector<std::unique_ptr<wavWriter>> stemFiles;
+        auto removeAll = [&]() {
+            std::filesystem::remove(path);
+            for(unsigned short i = 0; i < stemFiles.size(); i++) std::filesystem::remove(stemPath(path, i));
+        };
+        if(stems) {
+            for(unsigned short i = 0; i < instrumentCount; i++) {
+                stemFiles.push_back(std::make_unique<wavWriter>());
+                if(!stemFiles.back()->open(stemPath(path, i), sampleRate)) {
+                    file.close();
+                    stemFiles.pop_back();
+                    for(std::unique_ptr<wavWriter> &stemFile : stemFiles) stemFile->close();
+                    removeAll();
+                    error = "Couldn't open the file for stem " + std::to_string(i);
+                    status = renderStatus::failed;
+                    return;
+                }
+            }
+        }
+        unsigned int threadCount = threads == 0 ? std::thread::hardware_concurrency() : threads;
+        threadCount = std::clamp<unsigned int>(threadCount, 1, std::max<unsigned short>(instrumentCount, 1));
+        // Stems need a buffer per instrument, so with a lot of instruments
+        // the chunks get shorter to keep them to stemBufferSamples in all
+        size_t chunkFrames = chunkLength;
+        if(stems) chunkFrames = std::clamp<size_t>(stemBufferSamples / std::max<unsigned short>(instrumentCount, 1),
+                                                   minimumChunkLength, chunkLength);
+        std::vector<std::vector<short>> stemBuffers(stems ? instrumentCount : 0, std::vector<short>(chunkFrames));
+        std::vector<short> block(chunkFrames);
+
+        engine.setPosition(0, 0);
+        engine.start(sampleRate);
+        engine.cue();
+        for(size_t done = 0; done < timing.length; done += chunkFrames) {
+            if(cancelRequested) {
+                file.close();
+                for(std::unique_ptr<wavWriter> &stemFile : stemFiles) stemFile->close();
+                removeAll();
+                status = renderStatus::cancelled;
+                return;
+            }
+            size_t chunk = std::min(chunkFrames, timing.length - done);
+            engine.render(block.data(), chunk, threadCount, stems ? &stemBuffers : nullptr);
+            file.write(block.data(), chunk);
+            for(unsigned short i = 0; i < stemFiles.size(); i++) writeStem(*stemFiles[i], stemBuffers[i].data(), chunk);
+            rendered += chunk;
+        }
+        engine.stop();
+        bool written = file.close();
+        for(std::unique_ptr<wavWriter> &stemFile : stemFiles) written &= stemFile->close();
+        if(!written) {
+            error = "Couldn't write the file";
+            status = renderStatus::failed;
+            return;
+        }
+        status = renderStatus::done;
+    } catch(std::exception &e) {
+        error = e.what();
+        status = renderStatus::failed;
+    }
+}
+
+// Renders on this thread and returns how it went
+renderStatus renderJob::render() {
+    if(status != renderStatus::idle) throw std::logic_error("renderJob::render : already started");
+    status = renderStatus::running;
+    run();
+    return status;
+}
+
+// Renders on a new thread; watch getStatus() or isFinished()
+void renderJob::start() {
+    if(status != renderStatus::idle) throw std::logic_error("renderJob::start : already started");
+    status = renderStatus::running;
+    worker = std::thread(&renderJob::run, this);
+}
+
+// The render stops at the end of the chunk it's on and deletes the file
+void renderJob::cancel() {
+    cancelRequested = true;
+}
+
+renderStatus renderJob::getStatus() const {
+    return status;
+}
+
+bool renderJob::isFinished() const {
+    renderStatus s = status;
+    return s != renderStatus::idle && s != renderStatus::running;
+}
+
+// 0 to 1
+double renderJob::getProgress() const {
+    if(timing.length == 0) return 1;
+    return static_cast<double>(rendered) / timing.length;
+}
+
+// Only meaningful once the job has failed
+const std::string &renderJob::getError() const {
+    return error;
+}
+
+const std::filesystem::path &renderJob::getPath() const {
+    return path;
+}
+
+// Adds the instrument number to the file name, before the extension
+std::filesystem::path renderJob::stemPath(const std::filesystem::path &path, unsigned short instrument) {
+    char suffix[8];
+    std::snprintf(suffix, sizeof(suffix), "-%03u", instrument);
+    std::filesystem::path stem = path;
+    stem.replace_filename(path.stem().string() + suffix + path.extension().string());
+    return stem;
+}
+
+// Exact length and order start times of the render, in samples
+const songTiming &renderJob::getTiming() const {
+    return timing;
+}
@@ -41,6 +41,7 @@
 #include "log.hxx"
 #include "main.h"
 
+#include "callbackStats.hxx"
 #include "channel.hxx"
 #include "order.hxx"
 #include "visual.h"
@@ -349,7 +350,8 @@ void order(SDL_Renderer *renderer, const CursorPos &cursorPosition,
            orderIndexStorage &indexes) {
   text_drawText(renderer, "Order rows: ", 2, 0, 16, visual_whiteText, 0,
                 fontTileCountW);
-  std::array<char, 4> symbols;
+  // Room for five decimal digits, or four hex ones, and the terminator
+  std::array<char, 6> symbols;
   visual_numberToString(symbols.data(), indexes.rowCount());
   text_drawText(renderer, symbols.data(), 2, 13 * 16, 16, visual_whiteText, 0,
                 fontTileCountW);
@@ -375,41 +377,41 @@ void order(SDL_Renderer *renderer, const CursorPos &cursorPosition,
                        hexNumberIndex * 16, y, visual_whiteText,
                        i == cursorPosition.y);
     orderIndexRow *row = indexes.at(i);
-    unsigned char startingCollumn = static_cast<unsigned char>(
-        std::max(0, static_cast<short>(cursorPosition.x) -
-                        (static_cast<short>(fontTileCountW) - 4) / 6));
-    unsigned char currentCollumn = 0;
-    for (unsigned char j = startingCollumn; j < row->instCount(); j++) {
+    // Each cell is four digits and a space, after the four-digit row number
+    unsigned short startingCollumn = static_cast<unsigned short>(
+        std::max(0, static_cast<int>(cursorPosition.x) -
+                        (static_cast<short>(fontTileCountW) - 5) / 10));
+    unsigned short currentCollumn = 0;
+    for (unsigned short j = startingCollumn; j < row->instCount(); j++) {
 
       unsigned short x =
-          16 * (static_cast<unsigned short>(currentCollumn * 3) + 5);
+          16 * (static_cast<unsigned short>(currentCollumn * 5) + 5);
       if (x >= windowWidth)
         break;
       currentCollumn++;
-      unsigned char orderIndex = row->at(j);
+      unsigned short orderIndex = row->at(j);
 
-      hex2(orderIndex, symbols[0], symbols[1]);
+      hex4(orderIndex, symbols.data());
 
-      text_drawBigChar(renderer, indexes_charToIdx(symbols[0]), 2, x, y,
-                       (i == cursorPosition.y && j == cursorPosition.x) ||
-                               orderIndex != 0
-                           ? visual_greenText
-                           : SDL_Color{32, 64, 32, 255},
-                       i == cursorPosition.y && j == cursorPosition.x);
-      text_drawBigChar(renderer, indexes_charToIdx(symbols[1]), 2, x + 16, y,
-                       (i == cursorPosition.y && j == cursorPosition.x) ||
-                               orderIndex != 0
-                           ? visual_greenText
-                           : SDL_Color{32, 64, 32, 255},
-                       i == cursorPosition.y && j == cursorPosition.x);
+      for (unsigned char hexNumberIndex = 0; hexNumberIndex < 4;
+           hexNumberIndex++)
+        text_drawBigChar(renderer, indexes_charToIdx(symbols[hexNumberIndex]),
+                         2, x + hexNumberIndex * 16, y,
+                         (i == cursorPosition.y && j == cursorPosition.x) ||
+                                 orderIndex != 0
+                             ? visual_greenText
+                             : SDL_Color{32, 64, 32, 255},
+                         i == cursorPosition.y && j == cursorPosition.x);
 
       if (currentRow == 0) {
-        hex2(j, symbols[0], symbols[1]);
+        hex4(j, symbols.data());
 
-        text_drawBigChar(renderer, indexes_charToIdx(symbols[0]), 2, x, y - 16,
-                         visual_whiteText, j == cursorPosition.x);
-        text_drawBigChar(renderer, indexes_charToIdx(symbols[1]), 2, x + 16,
-                         y - 16, visual_whiteText, j == cursorPosition.x);
+        for (unsigned char hexNumberIndex = 0; hexNumberIndex < 4;
+             hexNumberIndex++)
+          text_drawBigChar(renderer,
+                           indexes_charToIdx(symbols[hexNumberIndex]), 2,
+                           x + hexNumberIndex * 16, y - 16, visual_whiteText,
+                           j == cursorPosition.x);
       }
     }
     currentRow++;
@@ -422,7 +424,7 @@ void pattern(SDL_Renderer *renderer, const int windowWidth,
              const unsigned int fontTileCountH, orderIndexStorage &indexes,
              const bool isAudioPlaying, const unsigned short currentPattern,
              const unsigned short currentlyViewedOrder,
-             instrumentStorage &instruments, const unsigned char currentRow,
+             instrumentStorage &instruments, const unsigned short currentRow,
              const CursorPos &cursorPosition, const char currentViewMode) {
   barrier(renderer, 48, windowWidth);
   if (orders.tableCount() == 0) {
@@ -440,43 +442,59 @@ void pattern(SDL_Renderer *renderer, const int windowWidth,
     text_drawBigChar(renderer, indexes_charToIdx(letters.at(hexNumberIndex)), 2,
                      (6 + hexNumberIndex) * 16, 16, visual_whiteText, 0);
 
-  unsigned char selectedInstrument =
+  unsigned short selectedInstrument =
       cursorPosition.x /
       patternMenu_instrumentVariableCount[static_cast<size_t>(currentViewMode)];
-  unsigned char selectedVariable =
+  unsigned short selectedVariable =
       cursorPosition.x %
       patternMenu_instrumentVariableCount[static_cast<size_t>(currentViewMode)];
+  // The narrowest columns only fit two digits of their instrument's number,
+  // so the selected one is always shown in full up here
+  text_drawText(renderer, "Inst", 2, 11 * 16, 16, visual_whiteText, 0, 4);
+  hex4(selectedInstrument, letters.data());
+  for (unsigned char hexNumberIndex = 0; hexNumberIndex < 4; hexNumberIndex++)
+    text_drawBigChar(renderer, indexes_charToIdx(letters.at(hexNumberIndex)), 2,
+                     (16 + hexNumberIndex) * 16, 16, visual_greenText, 0);
+
+  // Past 0x100 rows the row numbers take four digits and the columns move
+  // over to make room; past 0x100 instruments so do the column headers
+  const bool wideRowNumbers = orders.rowCount() > 0x100;
+  const bool wideInstrumentNumbers = orders.tableCount() > 0x100;
+  const unsigned short firstCollumn = wideRowNumbers ? 2 : 0;
+  const unsigned char instrumentCollumnWidth =
+      patternMenu_instrumentCollumnWidth[static_cast<size_t>(currentViewMode)];
 
   short instrumentScreenCount =
       fontTileCountW /
       patternMenu_instrumentCollumnWidth[static_cast<size_t>(currentViewMode)];
-  unsigned char firstInstrument =
-      std::max(0, static_cast<short>(selectedInstrument) -
+  unsigned short firstInstrument =
+      std::max(0, static_cast<int>(selectedInstrument) -
                       ((instrumentScreenCount - 1) / 2));
 
-  unsigned char startingCollumn = static_cast<unsigned char>(
-      std::max(0, static_cast<short>(selectedInstrument) -
+  unsigned short startingCollumn = static_cast<unsigned short>(
+      std::max(0, static_cast<int>(selectedInstrument) -
                       static_cast<short>((fontTileCountH - 10) / 2)));
   unsigned short currentCollumn = 0;
-  for (unsigned char collumnIndex = startingCollumn;
+  for (unsigned short collumnIndex = startingCollumn;
        collumnIndex < orderRow->instCount(); collumnIndex++) {
-    unsigned char orderIndex = orderRow->at(collumnIndex);
-    unsigned short x = currentCollumn * 48;
+    unsigned short orderIndex = orderRow->at(collumnIndex);
+    unsigned short x = currentCollumn * 80;
     if (x > windowWidth)
       break;
-    hex2(orderIndex, letters.at(0), letters.at(1));
-    text_drawBigChar(renderer, indexes_charToIdx(letters.at(0)), 2, x, 32,
-                     visual_greenText, collumnIndex == selectedInstrument);
-    text_drawBigChar(renderer, indexes_charToIdx(letters.at(1)), 2, x + 16, 32,
-                     visual_greenText, collumnIndex == selectedInstrument);
+    hex4(orderIndex, letters.data());
+    for (unsigned char hexNumberIndex = 0; hexNumberIndex < 4; hexNumberIndex++)
+      text_drawBigChar(renderer,
+                       indexes_charToIdx(letters.at(hexNumberIndex)), 2,
+                       x + hexNumberIndex * 16, 32, visual_greenText,
+                       collumnIndex == selectedInstrument);
     currentCollumn++;
   };
   currentCollumn = 0;
-  for (unsigned char instrumentIndex = firstInstrument;
+  for (unsigned short instrumentIndex = firstInstrument;
        instrumentIndex < orders.tableCount(); instrumentIndex++) {
     // if(16*(5+currentCollumn)>=windowWidth) break;
-    class order *currentOrder =
-        orders.at(instrumentIndex)->at(orderRow->at(instrumentIndex));
+    const class order *currentOrder =
+        orders.at(instrumentIndex)->view(orderRow->at(instrumentIndex));
 
     unsigned short startingRow = static_cast<unsigned short>(
         std::max(0, cursorY - static_cast<int>((fontTileCountH - 3) / 2)));
@@ -486,56 +504,77 @@ void pattern(SDL_Renderer *renderer, const int windowWidth,
       unsigned short y = currentRow * 16 + 80;
       if (y >= windowHeight)
         break;
-      if (currentCollumn >= fontTileCountW)
+      if (currentCollumn + firstCollumn >= fontTileCountW)
         break;
-      unsigned short localCurrentCollumn = currentCollumn;
+      unsigned short localCurrentCollumn = currentCollumn + firstCollumn;
       bool rowSeleted =
           selectedInstrument == instrumentIndex && rowIndex == cursorY;
 
       if (currentViewMode >= 1 && currentCollumn == 0)
-        text_drawBigChar(renderer, indexes_charToIdx('\x1c'), 2, 16 * 3, y,
-                         visual_greyText, 0);
+        text_drawBigChar(renderer, indexes_charToIdx('\x1c'), 2,
+                         16 * (3 + firstCollumn), y, visual_greyText, 0);
 
       if (currentCollumn == 0) {
-        hex2(rowIndex, letters.at(0), letters.at(1));
-        for (unsigned char hexNumberIndex = 0; hexNumberIndex < 2;
+        unsigned char rowDigits = wideRowNumbers ? 4 : 2;
+        hex4(rowIndex, letters.data());
+        for (unsigned char hexNumberIndex = 0; hexNumberIndex < rowDigits;
              hexNumberIndex++)
           text_drawBigChar(
-              renderer, indexes_charToIdx(letters.at(hexNumberIndex)), 2,
+              renderer,
+              indexes_charToIdx(letters.at(4 - rowDigits + hexNumberIndex)), 2,
               hexNumberIndex * 16, y, visual_greyText, cursorY == rowIndex);
       }
       if (currentRow == 0) {
-        if (patternMenu_instrumentCollumnWidth[static_cast<size_t>(
-                currentViewMode)] >= 13) {
-          text_drawText(
-              renderer,
-              getTypeName(instruments.at(instrumentIndex)->get_type(), false),
-              2, 16 * (7 + localCurrentCollumn), 64, visual_whiteText,
-              instrumentIndex == selectedInstrument ||
-                  (isAudioPlaying && cursorY == rowIndex),
-              10);
-        } else if (patternMenu_instrumentCollumnWidth[static_cast<size_t>(
-                       currentViewMode)] >= 5) {
-          text_drawText(
-              renderer,
-              getTypeName(instruments.at(instrumentIndex)->get_type(), true), 2,
-              16 * (7 + localCurrentCollumn), 64, visual_whiteText,
-              instrumentIndex == selectedInstrument ||
-                  (isAudioPlaying && cursorY == rowIndex),
-              2);
+        bool headerSelected = instrumentIndex == selectedInstrument ||
+                              (isAudioPlaying && cursorY == rowIndex);
+        // Four-digit numbers push the name over, or out of columns too narrow
+        // for both
+        unsigned char nameCollumn = wideInstrumentNumbers ? 9 : 7;
+        if (!wideInstrumentNumbers || instrumentCollumnWidth >= 12) {
+          if (instrumentCollumnWidth >= 13) {
+            text_drawText(
+                renderer,
+                getTypeName(instruments.at(instrumentIndex)->get_type(), false),
+                2, 16 * (nameCollumn + localCurrentCollumn), 64,
+                visual_whiteText, headerSelected, 10);
+          } else if (instrumentCollumnWidth >= 5) {
+            text_drawText(
+                renderer,
+                getTypeName(instruments.at(instrumentIndex)->get_type(), true),
+                2, 16 * (nameCollumn + localCurrentCollumn), 64,
+                visual_whiteText, headerSelected, 2);
+          }
+        }
+        hex4(instrumentIndex, letters.data());
+        if (!wideInstrumentNumbers ||
+            (instrumentCollumnWidth < 5 && instrumentIndex <= 0xFF)) {
+          text_drawBigChar(renderer, indexes_charToIdx(letters.at(2)), 2,
+                           16 * (4 + localCurrentCollumn), 64, visual_greenText,
+                           headerSelected);
+          text_drawBigChar(renderer, indexes_charToIdx(letters.at(3)), 2,
+                           16 * (5 + localCurrentCollumn), 64, visual_greenText,
+                           headerSelected);
+        } else if (instrumentCollumnWidth >= 5) {
+          for (unsigned char hexNumberIndex = 0; hexNumberIndex < 4;
+               hexNumberIndex++)
+            text_drawBigChar(
+                renderer, indexes_charToIdx(letters.at(hexNumberIndex)), 2,
+                16 * (4 + hexNumberIndex + localCurrentCollumn), 64,
+                visual_greenText, headerSelected);
+        } else {
+          // Too narrow for the whole number, which is shown in full above
+          // once this instrument is selected
+          text_drawBigChar(renderer, indexes_charToIdx('+'), 2,
+                           16 * (4 + localCurrentCollumn), 64, visual_greyText,
+                           headerSelected);
+          text_drawBigChar(renderer, indexes_charToIdx('+'), 2,
+                           16 * (5 + localCurrentCollumn), 64, visual_greyText,
+                           headerSelected);
         }
-        hex2(instrumentIndex, letters.at(0), letters.at(1));
-        text_drawBigChar(renderer, indexes_charToIdx(letters.at(0)), 2,
-                         16 * (4 + localCurrentCollumn), 64, visual_greenText,
-                         instrumentIndex == selectedInstrument ||
-                             (isAudioPlaying && cursorY == rowIndex));
-        text_drawBigChar(renderer, indexes_charToIdx(letters.at(1)), 2,
-                         16 * (5 + localCurrentCollumn), 64, visual_greenText,
-                         instrumentIndex == selectedInstrument ||
-                             (isAudioPlaying && cursorY == rowIndex));
       }
 
-      row *r = currentOrder->at(rowIndex);
+      row rowData = currentOrder->get(rowIndex);
+      const row *r = &rowData;
       switch (r->feature) {
       case rowFeature::note: {
         text_drawBigChar(renderer, indexes_charToIdx(hex(r->note - 'A')), 2,
@@ -693,11 +732,11 @@ void instruments(SDL_Renderer *renderer, const int windowHeight,
                  const CursorPos &cursorPosition) {
   text_drawText(renderer, "Instruments: ", 2, 0, 16, visual_whiteText, 0,
                 fontTileCountW);
-  unsigned char orderTableCount = orders.tableCount();
-  unsigned char instrumentCount = instruments.inst_count();
-  unsigned char orderIndexCount =
+  unsigned short orderTableCount = orders.tableCount();
+  unsigned short instrumentCount = instruments.inst_count();
+  unsigned short orderIndexCount =
       indexes.instCount(SDL_max(orderTableCount, instrumentCount));
-  unsigned char instCount =
+  unsigned short instCount =
       SDL_max(SDL_max(orderTableCount, instrumentCount), 0);
   if (instCount > 0)
     if (orderTableCount < instCount || instrumentCount < instCount ||
@@ -720,23 +759,22 @@ void instruments(SDL_Renderer *renderer, const int windowHeight,
                 visual_whiteText, 0, fontTileCountW);
   text_drawText(renderer, "C to change instrument type", 2, 0, 64,
                 visual_whiteText, 0, fontTileCountW);
-  unsigned char startingRow = static_cast<unsigned char>(
-      std::max(0, static_cast<short>(cursorPosition.y) -
-                      static_cast<unsigned char>(fontTileCountH / 2)));
-  unsigned char currentRow = 0;
-  for (unsigned char i = startingRow; i < instCount; i++) {
+  unsigned short startingRow = static_cast<unsigned short>(
+      std::max(0, static_cast<int>(cursorPosition.y) -
+                      static_cast<unsigned short>(fontTileCountH / 2)));
+  unsigned short currentRow = 0;
+  for (unsigned short i = startingRow; i < instCount; i++) {
     unsigned short y = 16 * (static_cast<unsigned short>(currentRow) + 6);
     if (y >= windowHeight)
       break;
-    char letter1, letter2;
-    hex2(i, letter1, letter2);
-
-    text_drawBigChar(renderer, indexes_charToIdx(letter1), 2, 0, y,
-                     visual_whiteText, i == cursorPosition.y);
-    text_drawBigChar(renderer, indexes_charToIdx(letter2), 2, 16, y,
-                     visual_whiteText, i == cursorPosition.y);
+    std::array<char, 4> digits;
+    hex4(i, digits.data());
+    for (unsigned char hexNumberIndex = 0; hexNumberIndex < 4; hexNumberIndex++)
+      text_drawBigChar(renderer, indexes_charToIdx(digits[hexNumberIndex]), 2,
+                       hexNumberIndex * 16, y, visual_whiteText,
+                       i == cursorPosition.y);
     text_drawText(renderer, getTypeName(instruments.at(i)->get_type(), false),
-                  2, 48, y, visual_whiteText, i == cursorPosition.y,
+                  2, 80, y, visual_whiteText, i == cursorPosition.y,
                   fontTileCountW);
     currentRow++;
   }
@@ -748,47 +786,43 @@ void order_management(SDL_Renderer *renderer, const int windowWidth,
                       const unsigned int fontTileCountH,
                       instrumentStorage &instruments,
                       const CursorPos &cursorPosition) {
-  unsigned char startingRow = static_cast<unsigned char>(
-      std::max(0, static_cast<short>(cursorPosition.y) -
+  unsigned short startingRow = static_cast<unsigned short>(
+      std::max(0, static_cast<int>(cursorPosition.y) -
                       static_cast<short>(fontTileCountH / 4)));
-  unsigned char currentRow = 0;
-  for (unsigned char i = startingRow; i < orders.tableCount(); i++) {
+  unsigned short currentRow = 0;
+  for (unsigned short i = startingRow; i < orders.tableCount(); i++) {
     unsigned short y = 16 * (static_cast<unsigned short>(currentRow) + 1);
     if (y >= windowHeight / 2)
       break;
-    char letter1;
-    char letter2;
-    hex2(i, letter1, letter2);
-    text_drawBigChar(renderer, indexes_charToIdx(letter1), 2, 0, y,
-                     visual_whiteText,
-                     i == (cursorPosition.subMenu ? cursorPosition.selection.y
-                                                  : cursorPosition.y));
-    text_drawBigChar(renderer, indexes_charToIdx(letter2), 2, 16, y,
-                     visual_whiteText,
-                     i == (cursorPosition.subMenu ? cursorPosition.selection.y
-                                                  : cursorPosition.y));
+    std::array<char, 4> digits;
+    hex4(i, digits.data());
+    for (unsigned char hexNumberIndex = 0; hexNumberIndex < 4; hexNumberIndex++)
+      text_drawBigChar(renderer, indexes_charToIdx(digits[hexNumberIndex]), 2,
+                       hexNumberIndex * 16, y, visual_whiteText,
+                       i == (cursorPosition.subMenu ? cursorPosition.selection.y
+                                                    : cursorPosition.y));
 
     instrumentOrderTable *table = orders.at(i);
-    unsigned char startingCollumn = static_cast<unsigned char>(
-        std::max(0, static_cast<short>(cursorPosition.x) -
-                        (static_cast<short>(fontTileCountW) - 4) / 6));
-    unsigned char currentCollumn = 0;
-    for (unsigned char j = startingCollumn; j < table->order_count(); j++) {
+    // Each pattern number is four digits and a space, as in the order menu
+    unsigned short startingCollumn = static_cast<unsigned short>(
+        std::max(0, static_cast<int>(cursorPosition.x) -
+                        (static_cast<short>(fontTileCountW) - 5) / 10));
+    unsigned short currentCollumn = 0;
+    for (unsigned short j = startingCollumn; j < table->order_count(); j++) {
       unsigned short x =
-          16 * (static_cast<unsigned short>(currentCollumn * 3) + 3);
-      hex2(j, letter1, letter2);
-      text_drawBigChar(renderer, indexes_charToIdx(letter1), 2, x, y,
-                       visual_greenText,
-                       cursorPosition.subMenu
-                           ? (i == cursorPosition.selection.y &&
-                              j == cursorPosition.selection.x)
-                           : (i == cursorPosition.y && j == cursorPosition.x));
-      text_drawBigChar(renderer, indexes_charToIdx(letter2), 2, x + 16, y,
-                       visual_greenText,
-                       cursorPosition.subMenu
-                           ? (i == cursorPosition.selection.y &&
-                              j == cursorPosition.selection.x)
-                           : (i == cursorPosition.y && j == cursorPosition.x));
+          16 * (static_cast<unsigned short>(currentCollumn * 5) + 5);
+      if (x >= windowWidth)
+        break;
+      hex4(j, digits.data());
+      for (unsigned char hexNumberIndex = 0; hexNumberIndex < 4;
+           hexNumberIndex++)
+        text_drawBigChar(
+            renderer, indexes_charToIdx(digits[hexNumberIndex]), 2,
+            x + hexNumberIndex * 16, y, visual_greenText,
+            cursorPosition.subMenu
+                ? (i == cursorPosition.selection.y &&
+                   j == cursorPosition.selection.x)
+                : (i == cursorPosition.y && j == cursorPosition.x));
       currentCollumn++;
     }
     currentRow++;
@@ -801,17 +835,19 @@ void order_management(SDL_Renderer *renderer, const int windowWidth,
                   visual_whiteText, 0, fontTileCountW);
     text_drawText(renderer, "C to clone selected order", 2, 0, ceiling + 32,
                   visual_whiteText, 0, fontTileCountW);
+    text_drawText(renderer, "D to remove duplicate orders", 2, 0,
+                  ceiling + 48, visual_whiteText, 0, fontTileCountW);
   } else {
     text_drawText(renderer, "Choose an instrument to clone to", 2, 0,
                   ceiling + 16, visual_whiteText, 0, fontTileCountW);
-    std::string digits = "012";
-    digits.at(2) = 0;
-    hex2(cursorPosition.x, digits.at(0), digits.at(1));
+    std::string digits = "01234";
+    digits.at(4) = 0;
+    hex4(cursorPosition.x, digits.data());
     text_drawText(renderer, digits.c_str(), 2, 0, ceiling + 48,
                   visual_whiteText, 0, fontTileCountW);
     text_drawText(
         renderer,
-        getTypeName(instruments.at(cursorPosition.x)->get_type(), false), 2, 48,
+        getTypeName(instruments.at(cursorPosition.x)->get_type(), false), 2, 80,
         ceiling + 48, visual_whiteText, 0, fontTileCountW);
   }
 }
@@ -898,11 +934,13 @@ void file(SDL_Renderer *renderer, const int windowWidth, const int windowHeight,
                   i == static_cast<int>(cursorPosition.y), fontTileCountW);
 }
 
-void file_save_render(SDL_Renderer *renderer, const int windowHeight,
+void file_save_render(SDL_Renderer *renderer, const int windowWidth,
+                      const int windowHeight,
                       const unsigned int fontTileCountW,
                       const CursorPos &cursorPosition, const bool render,
                       const std::string &fileName,
-                      const std::filesystem::path &fileMenuDirectory) {
+                      const std::filesystem::path &fileMenuDirectory,
+                      const double renderProgress) {
   text_drawText(renderer, render ? "Rendering to" : "Saving to", 2, 0, 16,
                 visual_whiteText, 0, fontTileCountW);
   text_drawText(renderer,
@@ -918,9 +956,21 @@ void file_save_render(SDL_Renderer *renderer, const int windowHeight,
                 fontTileCountW - 10);
   text_drawText(renderer, fileName.c_str(), 2, 0, 144, visual_whiteText, 0,
                 fontTileCountW - 10);
-  if (render)
-    text_drawText(renderer, "Program may not respond during render", 2, 0,
-                  windowHeight - 16, visual_yellowText, 0, fontTileCountW);
+  // A negative progress means nothing is rendering
+  if (render && renderProgress >= 0) {
+    std::string percent =
+        "Rendered " +
+        std::to_string(static_cast<int>(renderProgress * 100)) + "%";
+    text_drawText(renderer, percent.c_str(), 2, 0, 176, visual_whiteText, 0,
+                  fontTileCountW);
+    SDL_SetRenderDrawColor(renderer, 63, 127, 255, 255);
+    SDL_Rect barRectangle = {0, 192,
+                             static_cast<int>(windowWidth * renderProgress),
+                             16};
+    SDL_RenderFillRect(renderer, &barRectangle);
+    text_drawText(renderer, "Escape to cancel", 2, 0, windowHeight - 16,
+                  visual_yellowText, 0, fontTileCountW);
+  }
 }
 
 void log(SDL_Renderer *renderer, const int windowWidth, const int windowHeight,
@@ -975,7 +1025,7 @@ void screenUpdate(SDL_Renderer *renderer, SDL_Window *window,
                   const bool hasUnsavedChanges, const CursorPos &cursorPosition,
                   orderIndexStorage &indexes,
                   const unsigned short currentPattern,
-                  const unsigned char currentRow, orderStorage &orders,
+                  const unsigned short currentRow, orderStorage &orders,
                   const unsigned short currentlyViewedOrder,
                   const char currentViewMode, instrumentStorage &instruments,
                   const unsigned short tempo,
@@ -983,6 +1033,8 @@ void screenUpdate(SDL_Renderer *renderer, SDL_Window *window,
                   const std::filesystem::path &fileMenuDirectory,
                   const std::string saveFileName,
                   const std::string renderFileName,
+                  const double renderProgress,
+                  const callbackTimings &callbackTiming,
                   const std::filesystem::path &docPath) {
   long millis = SDL_GetTicks64();
   int windowWidth, windowHeight;
@@ -1047,14 +1099,15 @@ void screenUpdate(SDL_Renderer *renderer, SDL_Window *window,
                      fileMenuDirectory);
       break;
     case GlobalMenus::save_file_menu:
-      guiMenus::file_save_render(renderer, windowHeight, fontTileCountW,
-                                 cursorPosition, false, saveFileName,
-                                 fileMenuDirectory);
+      guiMenus::file_save_render(renderer, windowWidth, windowHeight,
+                                 fontTileCountW, cursorPosition, false,
+                                 saveFileName, fileMenuDirectory, -1);
       break;
     case GlobalMenus::render_menu:
-      guiMenus::file_save_render(renderer, windowHeight, fontTileCountW,
-                                 cursorPosition, true, renderFileName,
-                                 fileMenuDirectory);
+      guiMenus::file_save_render(renderer, windowWidth, windowHeight,
+                                 fontTileCountW, cursorPosition, true,
+                                 renderFileName, fileMenuDirectory,
+                                 renderProgress);
       break;
     case GlobalMenus::quit_confirmation_menu: {
       text_drawText(renderer, "Unsaved changes", 2,
@@ -1088,6 +1141,18 @@ void screenUpdate(SDL_Renderer *renderer, SDL_Window *window,
                     "d[I]smantle an index row\n"
                     "di[S]mantle an instrument",
                     2, 0, 118, visual_yellowText, 0, fontTileCountW);
+      std::string timing = fmt::format(
+          "Audio callback ({} calls, deadline {:.0f}us)\n"
+          "min {:.0f}us avg {:.0f}us max {:.0f}us p99 {:.0f}us\n"
+          "xruns (over {:.0f}%): {}\n"
+          "[T]iming to log  [Z]ero timing",
+          callbackTiming.count, callbackTiming.deadline, callbackTiming.min,
+          callbackTiming.average, callbackTiming.max, callbackTiming.p99,
+          callbackTiming.overrunFraction * 100, callbackTiming.overruns);
+      text_drawText(renderer, timing.c_str(), 2, 0, 176,
+                    callbackTiming.overruns > 0 ? visual_redText
+                                                : visual_greenText,
+                    0, fontTileCountW);
       break;
     }
     }
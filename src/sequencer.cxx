@@ -0,0 +1,86 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/sequencer.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+#include <algorithm>
+#include <stdexcept>
+#include "sequencer.hxx"
+
+// Tempo is in rows per minute; effects tick 8 times and arpeggios twice per
+// row.
+uint64_t sequencer::period(unsigned int perRow) const {
+    return (static_cast<uint64_t>(sampleRate) * 60 << 32) / (static_cast<uint64_t>(tempo) * perRow);
+}
+
+// Whole samples until the next event, keeping the fraction for the one after
+unsigned int sequencer::nextLength(uint64_t period, uint32_t &carry) const {
+    uint64_t exact = period + carry;
+    carry = static_cast<uint32_t>(exact);
+    return std::max<unsigned int>(1, exact >> 32);
+}
+
+void sequencer::start(unsigned short tempo, unsigned int sampleRate) {
+    if(tempo == 0) throw std::invalid_argument("sequencer::start : tempo can't be 0");
+    if(sampleRate == 0) throw std::invalid_argument("sequencer::start : sample rate can't be 0");
+    this->tempo = tempo;
+    this->sampleRate = sampleRate;
+    rowCarry = effectCarry = arpeggioCarry = 0;
+    timers = timerHandler();
+    rowTimer = timers.addTimer(nextLength(period(1), rowCarry));
+    effectTimer = timers.addTimer(nextLength(period(8), effectCarry));
+    arpeggioTimer = timers.addTimer(nextLength(period(2), arpeggioCarry));
+    running = true;
+}
+
+void sequencer::stop() {
+    running = false;
+}
+
+bool sequencer::isRunning() const {
+    return running;
+}
+
+// Takes effect as each event comes around again
+void sequencer::setTempo(unsigned short tempo) {
+    if(tempo == 0) throw std::invalid_argument("sequencer::setTempo : tempo can't be 0");
+    this->tempo = tempo;
+}
+
+unsigned int sequencer::samplesUntilEvent() {
+    return timers.ticksUntilNext();
+}
+
+sequencerEvents sequencer::advance(unsigned int samples) {
+    if(samples > samplesUntilEvent()) throw std::logic_error("sequencer::advance : skipped past an event");
+    sequencerEvents events;
+    timers.tick(samples);
+    if(timers.isComplete(rowTimer)) {
+        events.row = true;
+        timers.resetTimer(rowTimer, nextLength(period(1), rowCarry));
+    }
+    if(timers.isComplete(effectTimer)) {
+        events.effect = true;
+        timers.resetTimer(effectTimer, nextLength(period(8), effectCarry));
+    }
+    if(timers.isComplete(arpeggioTimer)) {
+        events.arpeggio = true;
+        timers.resetTimer(arpeggioTimer, nextLength(period(2), arpeggioCarry));
+    }
+    return events;
+}
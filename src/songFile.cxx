@@ -0,0 +1,257 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/songFile.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include "log.hxx"
+#include "main.h"
+#include "songFile.hxx"
+
+// The first minor version with two-byte counts and order indexes
+static constexpr unsigned char wideIndexVersion = 0x05;
+// The first minor version that only writes the rows that aren't blank
+static constexpr unsigned char sparsePatternVersion = 0x06;
+// A row number, then a row
+static constexpr size_t eventSize = 2 + 15;
+
+static void putShort(unsigned char *at, unsigned short value) {
+    at[0] = static_cast<unsigned char>(value >> 8);
+    at[1] = static_cast<unsigned char>(value & 255);
+}
+
+static unsigned short getShort(const unsigned char *at) {
+    return static_cast<unsigned short>(at[0]) << 8 | static_cast<unsigned short>(at[1]);
+}
+
+// 15 bytes: feature, note and octave, volume, then four effects
+static void packRow(const row &r, unsigned char *at) {
+    switch(r.feature) {
+        case rowFeature::empty:    at[0] = 0; break;
+        case rowFeature::note:     at[0] = 1; break;
+        case rowFeature::note_cut: at[0] = 2; break;
+    }
+    at[1] = ((r.note - 'A') & 15) << 4 | (r.octave & 15);
+    at[2] = r.volume;
+    for(unsigned char i = 0; i < 4; i++) {
+        unsigned char *e = at + 3 + (i * 3);
+        e[0] = static_cast<unsigned char>(r.effects[i].type);
+        putShort(e + 1, r.effects[i].effect);
+    }
+}
+
+static row unpackRow(const unsigned char *at) {
+    row r;
+    switch(at[0]) {
+        case 0:
+        default: r.feature = rowFeature::empty;    break;
+        case 1:  r.feature = rowFeature::note;     break;
+        case 2:  r.feature = rowFeature::note_cut; break;
+    }
+    r.note = (at[1] >> 4 & 15) + 'A';
+    r.octave = at[1] & 15;
+    r.volume = at[2];
+    for(unsigned char i = 0; i < 4; i++) {
+        const unsigned char *e = at + 3 + (i * 3);
+        r.effects[i].type = static_cast<effectTypes>(e[0]);
+        r.effects[i].effect = getShort(e + 1);
+    }
+    return r;
+}
+
+int saveSong(song &source, std::filesystem::path path) {
+    cmd::log::notice("Saving to file {}", path.string());
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    if(!file || !file.is_open()) {
+        cmd::log::error("Couldn't open the file");
+        return 1;
+    }
+    unsigned short instrumentCount = source.instruments.inst_count();
+    unsigned short orderCount = source.indexes.rowCount();
+
+    // Header, with unused space filled with FF
+    std::vector<unsigned char> buffer(256, 0xff);
+    std::copy_n("CHTRACKER", 9, buffer.begin());
+    buffer[9] = global_majorVersion;
+    buffer[10] = global_minorVersion;
+    buffer[11] = global_patchVersion;
+    buffer[12] = global_prereleaseVersion;
+    putShort(&buffer[13], source.tempo);
+    putShort(&buffer[15], source.patternLength);
+    putShort(&buffer[17], orderCount);
+    putShort(&buffer[19], instrumentCount);
+    file.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+    cmd::log::debug("Wrote header");
+
+    buffer.assign(instrumentCount * 8, 0xff);
+    for(unsigned short i = 0; i < instrumentCount; i++) {
+        buffer[i * 8] = static_cast<unsigned char>(source.instruments.at(i)->get_type());
+        putShort(&buffer[i * 8 + 1], source.orders.at(i)->order_count());
+    }
+    file.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+    cmd::log::debug("Wrote instrument table");
+
+    // Every order row has exactly one index per instrument
+    buffer.assign(instrumentCount * 2, 0);
+    for(unsigned short orderRowIndex = 0; orderRowIndex < orderCount; orderRowIndex++) {
+        orderIndexRow *indexRow = source.indexes.at(orderRowIndex);
+        for(unsigned short i = 0; i < instrumentCount; i++) {
+            putShort(&buffer[i * 2], i < indexRow->instCount() ? indexRow->at(i) : 0);
+        }
+        file.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+    }
+    cmd::log::debug("Wrote index data");
+
+    for(unsigned short tableIdx = 0; tableIdx < source.orders.tableCount(); tableIdx++) {
+        instrumentOrderTable *table = source.orders.at(tableIdx);
+        for(unsigned short orderIdx = 0; orderIdx < table->order_count(); orderIdx++) {
+            // The whole pattern goes out in one write: how many events it
+            // has, then each one
+            const order *o = table->view(orderIdx);
+            buffer.assign(2 + o->eventCount() * eventSize, 0xff);
+            putShort(&buffer[0], o->eventCount());
+            for(size_t event = 0; event < o->eventCount(); event++) {
+                unsigned char *e = &buffer[2 + event * eventSize];
+                putShort(e, o->eventRow(event));
+                packRow(o->eventAt(event), e + 2);
+            }
+            file.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+        }
+        cmd::log::debug("Wrote order table for instrument {}", tableIdx);
+    }
+    cmd::log::debug("Wrote order storage");
+    file.close();
+    cmd::log::debug("Saved successfully");
+    return 0;
+}
+
+int loadSong(song &target, std::filesystem::path filePath, char *&errorText) {
+    cmd::log::notice("Loading file {}", filePath.string());
+    std::ifstream file(filePath, std::ios::in | std::ios::binary);
+    if(!file || !file.is_open()) {
+        cmd::log::error("Couldn't open the file");
+        return 1;
+    }
+    std::vector<unsigned char> buffer(256);
+    file.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
+    for(int i = 0; i < 9; i++) {
+        if(buffer[i] != "CHTRACKER"[i]) {
+            errorText = const_cast<char *>("Not a chTRACKER file");
+            cmd::log::error(errorText);
+            cmd::log::debug("Mismatch on letter {}", i);
+            return 1;
+        }
+    }
+    if(buffer[12] != 0)
+        cmd::log::debug("File version {}.{}.{}.{}", static_cast<int>(buffer[9]), static_cast<int>(buffer[10]),
+                        static_cast<int>(buffer[11]), static_cast<char>('A' + buffer[12] - 1));
+    else
+        cmd::log::debug("File version {}.{}.{}", static_cast<int>(buffer[9]), static_cast<int>(buffer[10]),
+                        static_cast<int>(buffer[11]));
+    if(buffer[9] != global_majorVersion) {
+        errorText = const_cast<char *>("Major version mismatch");
+        cmd::log::error("Major verion mismatch, expected {} and got {}", global_majorVersion, buffer[9]);
+        return 1;
+    }
+    if(buffer[10] > global_minorVersion) {
+        errorText = const_cast<char *>("Newer minor version");
+        cmd::log::error("Newer minor verion, expected {} and got {}", global_minorVersion, buffer[10]);
+        return 1;
+    }
+    if(buffer[11] > global_patchVersion && buffer[10] == global_minorVersion) {
+        cmd::log::warning("Newer patch version, found {}", buffer[11]);
+    }
+    if(buffer[12] > 0 && global_prereleaseVersion == 0) {
+        cmd::log::warning("Opening prerelease file on non-prerelease version");
+    }
+    // Before 0.5 every count and index past the header was one byte, and
+    // before 0.6 every row of every pattern was written out
+    const bool wide = buffer[10] >= wideIndexVersion;
+    const bool sparse = buffer[10] >= sparsePatternVersion;
+    const size_t indexSize = wide ? 2 : 1;
+    auto getIndex = [wide](const unsigned char *at) -> unsigned short {
+        return wide ? getShort(at) : at[0];
+    };
+    unsigned short local_rowsPerMinute = target.tempo = getShort(&buffer[13]);
+    unsigned short local_rowsPerPattern = target.patternLength = getShort(&buffer[15]);
+    unsigned short local_orderCount = getShort(&buffer[17]);
+    unsigned short local_instrumentCount = getIndex(&buffer[19]);
+    cmd::log::debug("Tempo {}, {} rows per pattern, {} orders and {} instruments", local_rowsPerMinute,
+                    local_rowsPerPattern, local_orderCount, local_instrumentCount);
+    std::vector<unsigned short> instrumentOrderCounts(0);
+
+    buffer.resize(local_instrumentCount * 8);
+    file.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
+    cmd::log::debug("Creating instruments");
+    while(target.instruments.inst_count() > 0) target.instruments.remove_inst(target.instruments.inst_count() - 1);
+    for(unsigned short instrumentIdx = 0; instrumentIdx < local_instrumentCount; instrumentIdx++) {
+        const unsigned char *i = &buffer[instrumentIdx * 8];
+        target.instruments.add_inst(static_cast<audioChannelType>(i[0]));
+        instrumentOrderCounts.push_back(getIndex(i + 1));
+    }
+
+    buffer.resize(local_instrumentCount * indexSize);
+    cmd::log::debug("Reading index data");
+    while(target.indexes.rowCount() > 0) target.indexes.removeRow(target.indexes.rowCount() - 1);
+    for(unsigned short orderIdx = 0; orderIdx < local_orderCount; orderIdx++) {
+        file.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
+        orderIndexRow *r = target.indexes.at(target.indexes.addRow());
+        while(r->instCount() > 0) r->removeInst(r->instCount() - 1);
+        for(unsigned short instrumentIdx = 0; instrumentIdx < local_instrumentCount; instrumentIdx++) {
+            r->set(r->addInst(), getIndex(&buffer[instrumentIdx * indexSize]));
+        }
+    }
+
+    target.orders.setRowCount(local_rowsPerPattern);
+    cmd::log::debug("Reading order data");
+    while(target.orders.tableCount() > 0) target.orders.removeTable(target.orders.tableCount() - 1);
+    for(unsigned short tableIdx = 0; tableIdx < local_instrumentCount; tableIdx++) {
+        instrumentOrderTable *table = target.orders.at(target.orders.addTable());
+        table->set_row_count(local_rowsPerPattern);
+        for(unsigned short orderIdx = 0; orderIdx < instrumentOrderCounts.at(tableIdx); orderIdx++) {
+            order *oInternal = table->at(table->add_order());
+            oInternal->setRowCount(local_rowsPerPattern);
+            if(sparse) {
+                buffer.resize(2);
+                file.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
+                unsigned short eventCount = getShort(&buffer[0]);
+                buffer.resize(eventCount * eventSize);
+                file.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
+                for(unsigned short event = 0; event < eventCount; event++) {
+                    const unsigned char *e = &buffer[event * eventSize];
+                    unsigned short rowIdx = getShort(e);
+                    if(rowIdx < local_rowsPerPattern) oInternal->set(rowIdx, unpackRow(e + 2));
+                }
+            } else {
+                buffer.resize(static_cast<size_t>(local_rowsPerPattern) * 32);
+                file.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
+                for(unsigned short rowIdx = 0; rowIdx < local_rowsPerPattern; rowIdx++) {
+                    oInternal->set(rowIdx, unpackRow(&buffer[rowIdx * 32]));
+                }
+            }
+        }
+        cmd::log::debug("Read order table for instrument {}", tableIdx);
+    }
+    cmd::log::debug("{} patterns shared with an identical one", target.orders.intern());
+    file.close();
+    cmd::log::debug("File read successfully");
+    return 0;
+}
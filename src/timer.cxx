@@ -19,72 +19,110 @@
 */
 
 #include "timer.hxx"
-#include <string>
+#include <algorithm>
+#include <climits>
+#include <functional>
 #include <stdexcept>
 
-void timerHandler::addTimer(std::string name, unsigned int inXTicks) {
-    for(unsigned int i = 0; i < timers.size(); i++) {
-        if(timers.at(i).name == name) {
-            throw std::logic_error(const_cast<char *>("timerHandler::addTimer : timer already exists"));
-        }
-    }
-    timers.push_back({ name, inXTicks, inXTicks, timerStatus::ticking });
+static constexpr unsigned int slotBits = 20;
+static constexpr unsigned int slotMask = (1u << slotBits) - 1;
+
+// std::push_heap makes a max-heap, so order by the later deadline
+static bool laterDeadline(const std::pair<unsigned long long, timerID> &a,
+                          const std::pair<unsigned long long, timerID> &b) {
+    return a.first > b.first;
 }
 
-void timerHandler::tick() {
-    for(unsigned int i = 0; i < timers.size(); i++) {
-        timer &t = timers.at(i);
-        if(t.status==timerStatus::complete) continue;
-        if(t.ticksLeft > 0) t.ticksLeft--;
-        if(t.ticksLeft==0) t.status = timerStatus::complete;
-    }
+timer *timerHandler::find(timerID id) {
+    return const_cast<timer *>(static_cast<const timerHandler *>(this)->find(id));
 }
 
-bool timerHandler::isComplete(std::string name) {
-    for(unsigned int i = 0; i < timers.size(); i++) {
-        if(timers.at(i).name == name) {
-            return timers.at(i).status == timerStatus::complete;
-        }
-    }
-    throw std::logic_error(const_cast<char *>("timerHandler::isComplete : timer does not exist"));
+const timer *timerHandler::find(timerID id) const {
+    unsigned int slot = id & slotMask;
+    if(slot >= timers.size()) return nullptr;
+    const timer &t = timers[slot];
+    if(!t.used || t.generation != (id >> slotBits)) return nullptr;
+    return &t;
+}
+
+// A timer set for 0 ticks still waits for the next tick
+void timerHandler::schedule(timerID id, unsigned int inXTicks) {
+    timer &t = timers[id & slotMask];
+    t.deadline = now + std::max(1u, inXTicks);
+    t.status = timerStatus::ticking;
+    queue.push_back({t.deadline, id});
+    std::push_heap(queue.begin(), queue.end(), laterDeadline);
+}
+
+bool timerHandler::isCurrent(const std::pair<unsigned long long, timerID> &entry) const {
+    const timer *t = find(entry.second);
+    return t != nullptr && t->status == timerStatus::ticking && t->deadline == entry.first;
 }
 
-void timerHandler::resetTimer(std::string name, unsigned int inXTicks) {
-    for(unsigned int i = 0; i < timers.size(); i++) {
-        if(timers.at(i).name == name) {
-            timers.at(i).status = timerStatus::ticking;
-            timers.at(i).ticksLeft = inXTicks==0 ? timers.at(i).staringTicksLeft : inXTicks;
-            return;
-        }
+timerID timerHandler::addTimer(unsigned int inXTicks) {
+    unsigned int slot;
+    if(!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        if(timers.size() > slotMask) throw std::length_error("timerHandler::addTimer : too many timers");
+        slot = timers.size();
+        timers.push_back({0, 0, 0, timerStatus::ticking, false});
     }
-    throw std::logic_error(const_cast<char *>("timerHandler::resetTimer : timer does not exist"));
+    timer &t = timers[slot];
+    t.used = true;
+    t.staringTicksLeft = inXTicks;
+    timerID id = (t.generation << slotBits) | slot;
+    schedule(id, inXTicks);
+    return id;
 }
 
-bool timerHandler::hasTimer(std::string name) {
-    for(unsigned int i = 0; i < timers.size(); i++) {
-        if(timers.at(i).name == name) {
-            return true;
-        }
+// Only touches the timers that complete
+void timerHandler::tick(unsigned int ticks) {
+    now += ticks;
+    while(!queue.empty() && queue.front().first <= now) {
+        std::pair<unsigned long long, timerID> entry = queue.front();
+        std::pop_heap(queue.begin(), queue.end(), laterDeadline);
+        queue.pop_back();
+        if(isCurrent(entry)) find(entry.second)->status = timerStatus::complete;
     }
-    return false;
 }
 
-void timerHandler::removeTimer(std::string name) {
-    for(unsigned int i = 0; i < timers.size(); i++) {
-        if(timers.at(i).name == name) {   
-            for(unsigned char j = timers.size()-1; j>i; j--) {
-                timer t = timers.back();
-                timers.pop_back();
-                erase_timers.push_back(t);
-            }
-            timers.pop_back();
-            while(!erase_timers.empty()) {
-                timer t = erase_timers.back();
-                erase_timers.pop_back();
-                timers.push_back(t);
-            }
-            return;
-        }
+// How many ticks can pass before any timer completes (at least 1)
+unsigned int timerHandler::ticksUntilNext() {
+    while(!queue.empty() && !isCurrent(queue.front())) {
+        std::pop_heap(queue.begin(), queue.end(), laterDeadline);
+        queue.pop_back();
     }
-    throw std::logic_error(const_cast<char *>("timerHandler::removeTimer : timer does not exist"));
-}
\ No newline at end of file
+    if(queue.empty()) return UINT_MAX;
+    unsigned long long left = queue.front().first - now;
+    return static_cast<unsigned int>(std::min<unsigned long long>(std::max(1ull, left), UINT_MAX));
+}
+
+bool timerHandler::isComplete(timerID id) const {
+    const timer *t = find(id);
+    if(t == nullptr) throw std::logic_error(const_cast<char *>("timerHandler::isComplete : timer does not exist"));
+    return t->status == timerStatus::complete;
+}
+
+void timerHandler::resetTimer(timerID id, unsigned int inXTicks) {
+    timer *t = find(id);
+    if(t == nullptr) throw std::logic_error(const_cast<char *>("timerHandler::resetTimer : timer does not exist"));
+    schedule(id, inXTicks==0 ? t->staringTicksLeft : inXTicks);
+}
+
+bool timerHandler::hasTimer(timerID id) const {
+    return find(id) != nullptr;
+}
+
+void timerHandler::removeTimer(timerID id) {
+    timer *t = find(id);
+    if(t == nullptr) throw std::logic_error(const_cast<char *>("timerHandler::removeTimer : timer does not exist"));
+    t->used = false;
+    t->generation = (t->generation + 1) & (UINT_MAX >> slotBits);
+    freeSlots.push_back(id & slotMask);
+}
+
+unsigned int timerHandler::count() const {
+    return timers.size() - freeSlots.size();
+}
@@ -0,0 +1,166 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./src/wavWriter.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "wavWriter.hxx"
+
+static constexpr size_t headerSize = 44;
+
+static void write32LE(unsigned char *buffer, uint32_t a, size_t &bufferIdx) {
+    buffer[bufferIdx++] = static_cast<unsigned char>(a & 255);
+    buffer[bufferIdx++] = static_cast<unsigned char>(a >> 8 & 255);
+    buffer[bufferIdx++] = static_cast<unsigned char>(a >> 16 & 255);
+    buffer[bufferIdx++] = static_cast<unsigned char>(a >> 24 & 255);
+}
+
+static void write16LE(unsigned char *buffer, uint16_t a, size_t &bufferIdx) {
+    buffer[bufferIdx++] = static_cast<unsigned char>(a & 255);
+    buffer[bufferIdx++] = static_cast<unsigned char>(a >> 8 & 255);
+}
+
+bool wavWriter::open(const std::filesystem::path &path, unsigned int sampleRate, bool threaded) {
+    if(file.is_open()) throw std::logic_error("wavWriter::open : already open");
+    file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file || !file.is_open()) return false;
+    dataBytes = 0;
+    failed = false;
+    finishing = false;
+    pending = false;
+    filling = 0;
+    for(std::vector<unsigned char> &buffer : buffers) {
+        buffer.clear();
+        buffer.reserve(bufferFrames * 2);
+    }
+
+    // Both sizes are 0 until close() knows them
+    unsigned char header[headerSize];
+    size_t headerIdx = 0;
+    memcpy(&header[headerIdx], "RIFF", 4);
+    headerIdx += 4;
+    write32LE(header, 0, headerIdx);
+    memcpy(&header[headerIdx], "WAVEfmt ", 8);
+    headerIdx += 8;
+    // fmt chunk length
+    write32LE(header, 16, headerIdx);
+    // PCM
+    write16LE(header, 1, headerIdx);
+    // Mono
+    write16LE(header, 1, headerIdx);
+    write32LE(header, sampleRate, headerIdx);
+    // (samplerate * bit depth * channel count) / 8
+    write32LE(header, sampleRate * 2, headerIdx);
+    // Bytes per frame
+    write16LE(header, 2, headerIdx);
+    // 16 bits
+    write16LE(header, 16, headerIdx);
+    memcpy(&header[headerIdx], "data", 4);
+    headerIdx += 4;
+    write32LE(header, 0, headerIdx);
+    file.write(reinterpret_cast<char *>(header), headerSize);
+
+    this->threaded = threaded;
+    if(threaded) writer = std::thread(&wavWriter::writerLoop, this);
+    return true;
+}
+
+void wavWriter::write(const short *samples, size_t frames) {
+    if(!file.is_open()) throw std::logic_error("wavWriter::write : not open");
+    while(frames > 0) {
+        std::vector<unsigned char> &buffer = buffers[filling];
+        size_t space = bufferFrames - buffer.size() / 2;
+        size_t count = std::min(space, frames);
+        if(dataBytes + count * 2 > UINT32_MAX - headerSize) throw std::length_error("wavWriter::write : WAV files can't be over 4GB");
+        for(size_t i = 0; i < count; i++) {
+            uint16_t sample = static_cast<uint16_t>(samples[i]);
+            buffer.push_back(static_cast<unsigned char>(sample & 255));
+            buffer.push_back(static_cast<unsigned char>(sample >> 8));
+        }
+        dataBytes += count * 2;
+        samples += count;
+        frames -= count;
+        if(buffer.size() / 2 == bufferFrames) flush();
+    }
+}
+
+// Hands the filling buffer to the disk. With a writer thread this only waits
+// if the other buffer still hasn't been written.
+void wavWriter::flush() {
+    std::vector<unsigned char> &buffer = buffers[filling];
+    if(buffer.empty()) return;
+    if(!threaded) {
+        if(!file.write(reinterpret_cast<char *>(buffer.data()), buffer.size())) failed = true;
+        buffer.clear();
+        return;
+    }
+    std::unique_lock<std::mutex> guard(lock);
+    wake.wait(guard, [this] { return !pending; });
+    pending = true;
+    filling ^= 1;
+    wake.notify_all();
+}
+
+void wavWriter::writerLoop() {
+    std::unique_lock<std::mutex> guard(lock);
+    while(true) {
+        wake.wait(guard, [this] { return pending || finishing; });
+        if(!pending) return;
+        std::vector<unsigned char> &buffer = buffers[filling ^ 1];
+        guard.unlock();
+        bool ok = static_cast<bool>(file.write(reinterpret_cast<char *>(buffer.data()), buffer.size()));
+        buffer.clear();
+        guard.lock();
+        if(!ok) failed = true;
+        pending = false;
+        wake.notify_all();
+    }
+}
+
+// Writes what's left, fills in the RIFF and data chunk sizes and closes the
+// file. Returns false if anything couldn't be written.
+bool wavWriter::close() {
+    if(!file.is_open()) return false;
+    flush();
+    if(threaded) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            finishing = true;
+        }
+        wake.notify_all();
+        writer.join();
+    }
+    unsigned char size[4];
+    size_t sizeIdx = 0;
+    write32LE(size, dataBytes + headerSize - 8, sizeIdx);
+    file.seekp(4);
+    file.write(reinterpret_cast<char *>(size), 4);
+    sizeIdx = 0;
+    write32LE(size, dataBytes, sizeIdx);
+    file.seekp(headerSize - 4);
+    file.write(reinterpret_cast<char *>(size), 4);
+    if(!file) failed = true;
+    file.close();
+    return !failed;
+}
+
+wavWriter::~wavWriter() {
+    if(file.is_open()) close();
+}
@@ -0,0 +1,67 @@
+/*
+  Copyright (C) 2024 Chase Taylor
+
+  This file is part of chTRACKER at path ./test/transpose.cxx
+
+  chTRACKER is free software: you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation, either version 3 of the License, or (at your option) any later
+  version.
+
+  chTRACKER is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  chTRACKER. If not, see <https://www.gnu.org/licenses/>.
+
+  Chase Taylor @ creset200@gmail.com
+*/
+
+// Checks order::transpose across the whole range a row can store, octaves 0
+// to 15. Run by `make check`; exits with 1 on the first wrong note.
+
+#include <cstdio>
+#include "order.hxx"
+
+struct transposeCase {
+    char note;
+    char octave;
+    int semitones;
+    char expectedNote;
+    char expectedOctave;
+};
+
+static const transposeCase cases[] = {
+    {'A', 0, 1, 'B', 0},
+    {'A', 0, -1, 'A', 0},   // Already the lowest note
+    {'L', 9, 1, 'A', 10},
+    {'A', 10, -1, 'L', 9},
+    {'C', 10, 1, 'D', 10},
+    {'K', 15, 1, 'L', 15},
+    {'L', 15, 1, 'L', 15},  // Already the highest note
+    {'E', 12, 24, 'E', 14},
+    {'E', 14, -36, 'E', 11},
+};
+
+int main() {
+    const size_t caseCount = sizeof(cases) / sizeof(cases[0]);
+    for(size_t i = 0; i < caseCount; i++) {
+        const transposeCase &c = cases[i];
+        order pattern(1);
+        row r;
+        r.feature = rowFeature::note;
+        r.note = c.note;
+        r.octave = c.octave;
+        pattern.set(0, r);
+        pattern.transpose(c.semitones);
+        row result = pattern.get(0);
+        if(result.note != c.expectedNote || result.octave != c.expectedOctave) {
+            std::fprintf(stderr, "%c-%d moved by %d gave %c-%d, expected %c-%d\n", c.note, c.octave, c.semitones,
+                         result.note, result.octave, c.expectedNote, c.expectedOctave);
+            return 1;
+        }
+    }
+    std::printf("%zu of %zu transpositions right\n", caseCount, caseCount);
+    return 0;
+}